@@ -0,0 +1,1368 @@
+/***************************************************************************************************************
+* Plugin:       SagaStats
+* Author:       Jinming Zhang
+* Description:  SagaStats offers modular damage process and meter systems to support adaptable status management
+****************************************************************************************************************/
+
+// CompiledDamagePipeline.cpp — 扁平执行计划：Slot 分配 + 谓词字节码编译 / 解释
+#include "DamagePipeline/CompiledDamagePipeline.h"
+#include "DamagePipeline/DamagePipeline.h"
+#include "DamagePipeline/DamagePredicate.h"
+#include "DamagePipeline/DamageCondition.h"
+#include "DamagePipeline/DamageCondition_Context.h"
+#include "DamagePipeline/DamageOperationBase.h"
+#include "DamagePipeline/DamageRule.h"
+#include "SagaStatsLog.h"
+#include "UObject/Package.h"
+#include "Algo/Reverse.h"
+#include "Algo/StableSort.h"
+
+int32 FCompiledDamagePipeline::FindOrAddEffectSlot(UScriptStruct* EffectType)
+{
+	if (Layout->IsFinalized())
+	{
+		// 增量编译：布局已由 ExtendLayout 补齐
+		const int32 Slot = Layout->FindSlot(EffectType);
+		check(Slot != INDEX_NONE || !EffectType);
+		return Slot;
+	}
+	return Layout->FindOrAddSlot(EffectType);
+}
+
+int32 FCompiledDamagePipeline::FindEffectSlot(const UScriptStruct* EffectType) const
+{
+	return Layout->FindSlot(EffectType);
+}
+
+void FCompiledDamagePipeline::Reset()
+{
+	Rules.Reset();
+	Layout = MakeShared<FDamageEffectLayout>();
+	PredicateCode.Reset();
+	Conditions.Reset();
+	ConditionHashes.Reset();
+	ConditionIndexByHash.Reset();
+	Subexprs.Reset();
+	MemoSafe.Reset();
+	bCompiled = false;
+	bThreadSafe = false;
+	ReadSlots.Reset();
+	Operations.Reset();
+	LevelRules.Reset();
+	LevelStarts.Reset();
+	MaxLevelWidth = 0;
+}
+
+// ============================================================================
+// 编译
+// ============================================================================
+
+UDamageOperationBase* FCompiledDamagePipeline::FindOrCreateOperation(UClass* OperationClass)
+{
+	if (!OperationClass) return nullptr;
+
+	for (UDamageOperationBase* Operation : Operations)
+	{
+		if (Operation->GetClass() == OperationClass)
+		{
+			return Operation;
+		}
+	}
+
+	UDamageOperationBase* NewOp = NewObject<UDamageOperationBase>(GetTransientPackage(), OperationClass);
+	Operations.Add(NewOp);
+	return NewOp;
+}
+
+void FCompiledDamagePipeline::CompileRule(UDamageRule* Rule, FCompiledDamageRule& Compiled)
+{
+	Compiled.Rule = Rule;
+	CompilePredicate(Rule->Condition, Compiled);
+
+	if (Rule->OperationClass)
+	{
+		Compiled.Operation = FindOrCreateOperation(Rule->OperationClass);
+		Compiled.EffectType = Rule->GetProducesEffectType();
+		Compiled.EffectSlot = FindOrAddEffectSlot(Compiled.EffectType);
+	}
+
+	// 消费的 EffectType（谓词 + Operation 声明）同样分配 Slot（攻击上下文等外部输入也在其中）
+	Compiled.ReadSlotStart = ReadSlots.Num();
+	for (UScriptStruct* Type : Rule->GetConsumedEffectTypes())
+	{
+		ReadSlots.Add(FindOrAddEffectSlot(Type));
+	}
+	Compiled.ReadSlotNum = ReadSlots.Num() - Compiled.ReadSlotStart;
+}
+
+void FCompiledDamagePipeline::Finish()
+{
+	// Slot 集合已确定：计算 Arena 布局（Context 据此一次性分配 Effect 内存）
+	Layout->Finalize();
+
+	// 线程安全：所有 Operation 与叶子 Condition 都声明 IsThreadSafe 才允许并行执行
+	bThreadSafe = true;
+	for (const FCompiledDamageRule& Compiled : Rules)
+	{
+		if (Compiled.Operation && !Compiled.Operation->IsThreadSafe())
+		{
+			bThreadSafe = false;
+		}
+	}
+	for (const UDamageCondition* Condition : Conditions)
+	{
+		if (!Condition->IsThreadSafe())
+		{
+			bThreadSafe = false;
+		}
+	}
+
+	// 蓝图事件分发：无蓝图 override 的类改为直调 _Implementation
+	int32 NumScriptDispatch = 0;
+	for (UDamageOperationBase* Operation : Operations)
+	{
+		Operation->ResolveNativeDispatch();
+		NumScriptDispatch += Operation->UsesScriptDispatch() ? 1 : 0;
+	}
+	for (const UDamageCondition* Condition : Conditions)
+	{
+		Condition->ResolveNativeDispatch();
+		NumScriptDispatch += Condition->UsesScriptDispatch() ? 1 : 0;
+	}
+	UE_LOG(LogSagaStats, Verbose, TEXT("编译计划: %d 个 Operation/Condition 经蓝图事件分发，其余直调原生实现"),
+		NumScriptDispatch);
+
+	// 拓扑分层（bParallelLevels 使用）
+	BuildLevels();
+
+	ComputeMemoSafety();
+
+	bCompiled = true;
+}
+
+void FCompiledDamagePipeline::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (FCompiledDamageRule& Compiled : Rules)
+	{
+		Collector.AddReferencedObject(Compiled.Rule);
+	}
+	// Condition 是 Rule 的 Instanced 子对象；去重后可能被其他 Rule 引用，其所属 Rule 移除后仍须存活
+	for (const UDamageCondition*& Condition : Conditions)
+	{
+		Collector.AddReferencedObject(Condition);
+	}
+	for (UDamageOperationBase*& Operation : Operations)
+	{
+		Collector.AddReferencedObject(Operation);
+	}
+}
+
+// ============================================================================
+// 增量修改
+// ============================================================================
+
+void FCompiledDamagePipeline::ExtendLayout(TConstArrayView<UScriptStruct*> Types)
+{
+	const bool bMissing = Types.ContainsByPredicate([this](const UScriptStruct* Type)
+	{
+		return Type && FindEffectSlot(Type) == INDEX_NONE;
+	});
+	if (!bMissing)
+	{
+		return;
+	}
+
+	// 布局封闭后不可变（可能正被 Context 共享）：复制已有 Slot 顺序后追加
+	TSharedRef<FDamageEffectLayout> NewLayout = MakeShared<FDamageEffectLayout>();
+	for (UScriptStruct* Type : Layout->SlotTypes)
+	{
+		NewLayout->FindOrAddSlot(Type);
+	}
+	for (UScriptStruct* Type : Types)
+	{
+		NewLayout->FindOrAddSlot(Type);
+	}
+	NewLayout->Finalize();
+	Layout = NewLayout;
+}
+
+void FCompiledDamagePipeline::RemoveRuleAt(int32 RuleIndex)
+{
+	const FCompiledDamageRule Removed = Rules[RuleIndex];
+	Rules.RemoveAt(RuleIndex);
+
+	// 删去区间，位于其后的区间前移
+	PredicateCode.RemoveAt(Removed.PredicateStart, Removed.PredicateNum, EAllowShrinking::No);
+	ReadSlots.RemoveAt(Removed.ReadSlotStart, Removed.ReadSlotNum, EAllowShrinking::No);
+	for (FCompiledDamageRule& Rule : Rules)
+	{
+		if (Rule.PredicateStart > Removed.PredicateStart)
+		{
+			Rule.PredicateStart -= Removed.PredicateNum;
+		}
+		if (Rule.ReadSlotStart > Removed.ReadSlotStart)
+		{
+			Rule.ReadSlotStart -= Removed.ReadSlotNum;
+		}
+	}
+	for (FDamagePredicateSubexpr& Subexpr : Subexprs)
+	{
+		if (Subexpr.Start > Removed.PredicateStart)
+		{
+			Subexpr.Start -= Removed.PredicateNum;
+		}
+	}
+
+	// 压紧 Subexprs：只保留剩余 Rule（经共享子谓词传递地）仍引用的条目，删去其余 Body。
+	// Body 自底向上发射，外层只引用下标更小的内层——逆序一趟即闭包
+	TBitArray<> LiveSubexprs(false, Subexprs.Num());
+	auto MarkSubexprs = [this, &LiveSubexprs](int32 Start, int32 Num)
+	{
+		for (int32 PC = Start; PC < Start + Num; ++PC)
+		{
+			if (PredicateCode[PC].Op == EDamagePredicateOp::Subexpr)
+			{
+				LiveSubexprs[PredicateCode[PC].Operand] = true;
+			}
+		}
+	};
+	for (const FCompiledDamageRule& Rule : Rules)
+	{
+		MarkSubexprs(Rule.PredicateStart, Rule.PredicateNum);
+	}
+	for (int32 Index = Subexprs.Num() - 1; Index >= 0; --Index)
+	{
+		if (LiveSubexprs[Index])
+		{
+			MarkSubexprs(Subexprs[Index].Start, Subexprs[Index].Num);
+		}
+	}
+
+	if (LiveSubexprs.Contains(false))
+	{
+		TBitArray<> KeepInstrs(true, PredicateCode.Num());
+		for (int32 Index = 0; Index < Subexprs.Num(); ++Index)
+		{
+			if (!LiveSubexprs[Index])
+			{
+				KeepInstrs.SetRange(Subexprs[Index].Start, Subexprs[Index].Num, false);
+			}
+		}
+
+		// 指令新位置 = 之前保留的指令数（跳转偏移只在区间内部，不受影响）
+		TArray<int32> NewPosition;
+		NewPosition.SetNumUninitialized(PredicateCode.Num() + 1);
+		int32 NumKeptInstrs = 0;
+		for (int32 PC = 0; PC < PredicateCode.Num(); ++PC)
+		{
+			NewPosition[PC] = NumKeptInstrs;
+			if (KeepInstrs[PC])
+			{
+				PredicateCode[NumKeptInstrs++] = PredicateCode[PC];
+			}
+		}
+		NewPosition[PredicateCode.Num()] = NumKeptInstrs;
+		PredicateCode.SetNum(NumKeptInstrs, EAllowShrinking::No);
+
+		for (FCompiledDamageRule& Rule : Rules)
+		{
+			Rule.PredicateStart = NewPosition[Rule.PredicateStart];
+		}
+
+		TArray<int32> SubexprRemap;
+		SubexprRemap.Init(INDEX_NONE, Subexprs.Num());
+		int32 NumKeptSubexprs = 0;
+		for (int32 Index = 0; Index < Subexprs.Num(); ++Index)
+		{
+			if (LiveSubexprs[Index])
+			{
+				Subexprs[NumKeptSubexprs] = Subexprs[Index];
+				Subexprs[NumKeptSubexprs].Start = NewPosition[Subexprs[NumKeptSubexprs].Start];
+				SubexprRemap[Index] = NumKeptSubexprs++;
+			}
+		}
+		Subexprs.SetNum(NumKeptSubexprs, EAllowShrinking::No);
+
+		for (FDamagePredicateInstr& Instr : PredicateCode)
+		{
+			if (Instr.Op == EDamagePredicateOp::Subexpr)
+			{
+				Instr.Operand = SubexprRemap[Instr.Operand];
+			}
+		}
+	}
+
+	// 压紧 Conditions：只保留剩余字节码仍引用的条目，并重映射指令下标
+	TArray<int32> Remap;
+	Remap.Init(INDEX_NONE, Conditions.Num());
+	for (const FDamagePredicateInstr& Instr : PredicateCode)
+	{
+		if (Instr.Op == EDamagePredicateOp::Condition)
+		{
+			Remap[Instr.Operand] = 0;
+		}
+	}
+
+	int32 NumKept = 0;
+	for (int32 Index = 0; Index < Conditions.Num(); ++Index)
+	{
+		if (Remap[Index] != INDEX_NONE)
+		{
+			Conditions[NumKept] = Conditions[Index];
+			ConditionHashes[NumKept] = ConditionHashes[Index];
+			Remap[Index] = NumKept++;
+		}
+	}
+	Conditions.SetNum(NumKept, EAllowShrinking::No);
+	ConditionHashes.SetNum(NumKept, EAllowShrinking::No);
+
+	ConditionIndexByHash.Reset();
+	for (int32 Index = 0; Index < ConditionHashes.Num(); ++Index)
+	{
+		ConditionIndexByHash.Add(ConditionHashes[Index], Index);
+	}
+
+	for (FDamagePredicateInstr& Instr : PredicateCode)
+	{
+		if (Instr.Op == EDamagePredicateOp::Condition)
+		{
+			Instr.Operand = Remap[Instr.Operand];
+		}
+	}
+}
+
+// ============================================================================
+// 烘焙计划
+// ============================================================================
+
+void FCompiledDamagePipeline::ExportCooked(FDamageCookedPlan& Out) const
+{
+	Out.Reset();
+	Out.Version = FDamageCookedPlan::CurrentVersion;
+
+	Out.SlotTypes.Append(Layout->SlotTypes);
+
+	Out.Rules.Reserve(Rules.Num());
+	for (const FCompiledDamageRule& Compiled : Rules)
+	{
+		FDamageCookedRule& Cooked = Out.Rules.AddDefaulted_GetRef();
+		Cooked.Rule = Compiled.Rule;
+		Cooked.PredicateStart = Compiled.PredicateStart;
+		Cooked.PredicateNum = Compiled.PredicateNum;
+		Cooked.EffectSlot = Compiled.Operation ? Compiled.EffectSlot : INDEX_NONE;
+		Cooked.ReadSlotStart = Compiled.ReadSlotStart;
+		Cooked.ReadSlotNum = Compiled.ReadSlotNum;
+	}
+
+	Out.PredicateCode.Reserve(PredicateCode.Num());
+	for (const FDamagePredicateInstr& Instr : PredicateCode)
+	{
+		Out.PredicateCode.Add(static_cast<int64>(Instr.Operand) << 16
+			| static_cast<int64>(Instr.bNegate) << 8
+			| static_cast<int64>(Instr.Op));
+	}
+
+	for (const UDamageCondition* Condition : Conditions)
+	{
+		Out.Conditions.Add(const_cast<UDamageCondition*>(Condition));
+	}
+
+	for (const FDamagePredicateSubexpr& Subexpr : Subexprs)
+	{
+		FDamageCookedSubexpr& Cooked = Out.Subexprs.AddDefaulted_GetRef();
+		Cooked.Start = Subexpr.Start;
+		Cooked.Num = Subexpr.Num;
+		Cooked.Cost = Subexpr.Cost;
+		Cooked.Representative = const_cast<UDamagePredicate*>(Subexpr.Representative.Get());
+	}
+
+	Out.ReadSlots = ReadSlots;
+}
+
+bool FCompiledDamagePipeline::ImportCooked(const FDamageCookedPlan& In)
+{
+	Reset();
+
+	auto IsValidRange = [](int32 Start, int32 Num, int32 Size)
+	{
+		return Start >= 0 && Num >= 0 && Start + Num <= Size;
+	};
+
+	// 被引用的类型 / 对象在加载后丢失（资产被删、类被移除）时放弃，交给常规编译报告
+	for (UScriptStruct* Type : In.SlotTypes)
+	{
+		if (!Type) return false;
+		Layout->FindOrAddSlot(Type);
+	}
+	const int32 NumSlots = Layout->Num();
+
+	// 内容哈希按本进程重新计算：后续 AddRule 的 Condition 去重 / 子谓词复用依赖它们
+	for (const TObjectPtr<UDamageCondition>& Condition : In.Conditions)
+	{
+		if (!Condition) return false;
+		const uint32 Hash = HashObjectContent(Condition);
+		ConditionIndexByHash.Add(Hash, Conditions.Add(Condition.Get()));
+		ConditionHashes.Add(Hash);
+	}
+
+	PredicateCode.Reserve(In.PredicateCode.Num());
+	for (int64 Packed : In.PredicateCode)
+	{
+		FDamagePredicateInstr& Instr = PredicateCode.AddDefaulted_GetRef();
+		Instr.Op = static_cast<EDamagePredicateOp>(Packed & 0xFF);
+		Instr.bNegate = ((Packed >> 8) & 0xFF) != 0;
+		Instr.Operand = static_cast<int32>(Packed >> 16);
+
+		if (Instr.Op > EDamagePredicateOp::Subexpr
+			|| (Instr.Op == EDamagePredicateOp::Condition && !Conditions.IsValidIndex(Instr.Operand))
+			|| (Instr.Op == EDamagePredicateOp::Subexpr && !In.Subexprs.IsValidIndex(Instr.Operand)))
+		{
+			return false;
+		}
+	}
+
+	for (const FDamageCookedSubexpr& Cooked : In.Subexprs)
+	{
+		if (!IsValidRange(Cooked.Start, Cooked.Num, PredicateCode.Num())) return false;
+
+		FDamagePredicateSubexpr& Subexpr = Subexprs.AddDefaulted_GetRef();
+		Subexpr.Start = Cooked.Start;
+		Subexpr.Num = Cooked.Num;
+		Subexpr.Cost = Cooked.Cost;
+		Subexpr.Representative = Cooked.Representative.Get();
+		Subexpr.Hash = HashPredicateContent(Cooked.Representative);
+	}
+
+	for (int32 Slot : In.ReadSlots)
+	{
+		if (Slot < 0 || Slot >= NumSlots) return false;
+	}
+	ReadSlots = In.ReadSlots;
+
+	Rules.Reserve(In.Rules.Num());
+	for (const FDamageCookedRule& Cooked : In.Rules)
+	{
+		if (!Cooked.Rule
+			|| !IsValidRange(Cooked.PredicateStart, Cooked.PredicateNum, PredicateCode.Num())
+			|| !IsValidRange(Cooked.ReadSlotStart, Cooked.ReadSlotNum, ReadSlots.Num())
+			|| (Cooked.EffectSlot != INDEX_NONE && (Cooked.EffectSlot < 0 || Cooked.EffectSlot >= NumSlots)))
+		{
+			return false;
+		}
+
+		FCompiledDamageRule& Compiled = Rules.AddDefaulted_GetRef();
+		Compiled.Rule = Cooked.Rule;
+		Compiled.PredicateStart = Cooked.PredicateStart;
+		Compiled.PredicateNum = Cooked.PredicateNum;
+		Compiled.ReadSlotStart = Cooked.ReadSlotStart;
+		Compiled.ReadSlotNum = Cooked.ReadSlotNum;
+
+		// 产出类型取自布局，不再经 Operation CDO 解析
+		if (Cooked.EffectSlot != INDEX_NONE && Cooked.Rule->OperationClass)
+		{
+			Compiled.Operation = FindOrCreateOperation(Cooked.Rule->OperationClass);
+			Compiled.EffectSlot = Cooked.EffectSlot;
+			Compiled.EffectType = Layout->SlotTypes[Cooked.EffectSlot];
+		}
+	}
+
+	Finish();
+	return true;
+}
+
+// ============================================================================
+// 依赖图（CSR）与稳定拓扑排序
+// ============================================================================
+
+void FDamageRuleGraph::Reset(int32 ExpectedNodes, int32 ExpectedEdges)
+{
+	DependencyStarts.Reset(ExpectedNodes + 1);
+	Dependencies.Reset(ExpectedEdges);
+	DependentStarts.Reset();
+	Dependents.Reset();
+}
+
+void FDamageRuleGraph::Finalize()
+{
+	DependencyStarts.Add(Dependencies.Num());
+	const int32 NumNodes = Num();
+
+	// 计数排序生成反向邻接：按下游下标顺序填入，各上游的下游列表天然升序
+	DependentStarts.Init(0, NumNodes + 1);
+	for (int32 Upstream : Dependencies)
+	{
+		++DependentStarts[Upstream + 1];
+	}
+	for (int32 Node = 0; Node < NumNodes; ++Node)
+	{
+		DependentStarts[Node + 1] += DependentStarts[Node];
+	}
+
+	Dependents.SetNumUninitialized(Dependencies.Num());
+	TArray<int32> Cursor(DependentStarts.GetData(), NumNodes);
+	for (int32 Node = 0; Node < NumNodes; ++Node)
+	{
+		for (int32 Upstream : GetDependencies(Node))
+		{
+			Dependents[Cursor[Upstream]++] = Node;
+		}
+	}
+}
+
+bool FDamageRuleGraph::StableSort(TArray<int32>& OutOrder) const
+{
+	const int32 NumNodes = Num();
+	OutOrder.Reset(NumNodes);
+
+	TArray<int32> InDegree;
+	InDegree.SetNumUninitialized(NumNodes);
+	TArray<int32> ReadyHeap;
+	ReadyHeap.Reserve(NumNodes);
+	for (int32 Node = 0; Node < NumNodes; ++Node)
+	{
+		InDegree[Node] = DependencyStarts[Node + 1] - DependencyStarts[Node];
+		if (InDegree[Node] == 0)
+		{
+			// 按下标递增追加，本身即合法的小顶堆
+			ReadyHeap.Add(Node);
+		}
+	}
+
+	while (ReadyHeap.Num() > 0)
+	{
+		int32 Current;
+		ReadyHeap.HeapPop(Current, EAllowShrinking::No);
+		OutOrder.Add(Current);
+
+		for (int32 Dependent : GetDependents(Current))
+		{
+			if (--InDegree[Dependent] == 0)
+			{
+				ReadyHeap.HeapPush(Dependent);
+			}
+		}
+	}
+
+	return OutOrder.Num() == NumNodes;
+}
+
+// ============================================================================
+// 拓扑分层
+// ============================================================================
+//
+// 按 Rules（已是拓扑序）顺序贪心分层：Rule 的层 = 与它冲突的所有先前 Rule 的层 + 1 的最大值。
+//   RAW：读 Slot S → 高于 S 的所有先前写者
+//   WAR：写 Slot S → 高于 S 的所有先前读者
+//   WAW：写 Slot S → 高于 S 的所有先前写者
+// 只需记录每个 Slot 的最高读层 / 最高写层。冲突对的先后次序与 Rules 顺序一致，
+// 故逐层执行与串行执行的结果相同。
+
+void FCompiledDamagePipeline::BuildLevels()
+{
+	const int32 NumSlots = Layout->Num();
+	TArray<int32> SlotReadLevel;
+	TArray<int32> SlotWriteLevel;
+	SlotReadLevel.Init(INDEX_NONE, NumSlots);
+	SlotWriteLevel.Init(INDEX_NONE, NumSlots);
+
+	TArray<int32> RuleLevel;
+	RuleLevel.SetNumUninitialized(Rules.Num());
+	int32 LevelCount = 0;
+
+	for (int32 RuleIndex = 0; RuleIndex < Rules.Num(); ++RuleIndex)
+	{
+		int32 Level = 0;
+		for (int32 Slot : GetReadSlots(Rules[RuleIndex]))
+		{
+			Level = FMath::Max(Level, SlotWriteLevel[Slot] + 1);
+		}
+
+		const int32 WriteSlot = Rules[RuleIndex].Operation ? Rules[RuleIndex].EffectSlot : INDEX_NONE;
+		if (WriteSlot != INDEX_NONE)
+		{
+			Level = FMath::Max(Level, SlotWriteLevel[WriteSlot] + 1);
+			Level = FMath::Max(Level, SlotReadLevel[WriteSlot] + 1);
+		}
+
+		for (int32 Slot : GetReadSlots(Rules[RuleIndex]))
+		{
+			SlotReadLevel[Slot] = FMath::Max(SlotReadLevel[Slot], Level);
+		}
+		if (WriteSlot != INDEX_NONE)
+		{
+			SlotWriteLevel[WriteSlot] = Level;
+		}
+
+		RuleLevel[RuleIndex] = Level;
+		LevelCount = FMath::Max(LevelCount, Level + 1);
+	}
+
+	// 计数排序：按层分桶，层内保持 Rules 顺序
+	LevelStarts.Init(0, LevelCount + 1);
+	for (int32 Level : RuleLevel)
+	{
+		++LevelStarts[Level + 1];
+	}
+	MaxLevelWidth = 0;
+	for (int32 Level = 0; Level < LevelCount; ++Level)
+	{
+		MaxLevelWidth = FMath::Max(MaxLevelWidth, LevelStarts[Level + 1]);
+		LevelStarts[Level + 1] += LevelStarts[Level];
+	}
+
+	LevelRules.SetNumUninitialized(Rules.Num());
+	TArray<int32> Cursor(LevelStarts);
+	for (int32 RuleIndex = 0; RuleIndex < Rules.Num(); ++RuleIndex)
+	{
+		LevelRules[Cursor[RuleLevel[RuleIndex]]++] = RuleIndex;
+	}
+}
+
+// ============================================================================
+// 按需子计划
+// ============================================================================
+//
+// 从请求 Slot 出发逆序遍历 Rules：Rule 写入"需要"的 Slot → 纳入子计划，其读取 Slot 也变为"需要"。
+// 同一 Slot 的所有先前写者都会被纳入（后写者谓词不成立时先写者的值留存，串行语义如此）。
+// 逆序一趟即闭包：Rule 只依赖 Rules 中排在它前面的写者。
+
+void FCompiledDamagePipeline::BuildSubPlan(TConstArrayView<int32> RequestedSlots, FDamageSubPlan& OutSubPlan) const
+{
+	TBitArray<> Needed(false, Layout->Num());
+	for (int32 Slot : RequestedSlots)
+	{
+		Needed[Slot] = true;
+	}
+
+	OutSubPlan.RequestedSlots.Reset();
+	OutSubPlan.RequestedSlots.Append(RequestedSlots.GetData(), RequestedSlots.Num());
+	OutSubPlan.RuleIndices.Reset();
+	for (int32 RuleIndex = Rules.Num() - 1; RuleIndex >= 0; --RuleIndex)
+	{
+		const FCompiledDamageRule& Rule = Rules[RuleIndex];
+		if (!Rule.Operation || Rule.EffectSlot == INDEX_NONE || !Needed[Rule.EffectSlot])
+		{
+			continue;
+		}
+
+		OutSubPlan.RuleIndices.Add(RuleIndex);
+		for (int32 Slot : GetReadSlots(Rule))
+		{
+			Needed[Slot] = true;
+		}
+	}
+	Algo::Reverse(OutSubPlan.RuleIndices);
+}
+
+// ============================================================================
+// 内容哈希 / 结构等价
+// ============================================================================
+
+namespace
+{
+	bool AreObjectsIdentical(const UObject* A, const UObject* B)
+	{
+		if (A == B) return true;
+		if (!A || !B || A->GetClass() != B->GetClass()) return false;
+
+		for (TFieldIterator<FProperty> It(A->GetClass()); It; ++It)
+		{
+			if (!It->Identical_InContainer(A, B))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const TArray<TObjectPtr<UDamagePredicate>>* GetChildPredicates(const UDamagePredicate* Node)
+	{
+		if (const UDamagePredicate_And* And = Cast<UDamagePredicate_And>(Node))
+		{
+			return &And->Predicates;
+		}
+		if (const UDamagePredicate_Or* Or = Cast<UDamagePredicate_Or>(Node))
+		{
+			return &Or->Predicates;
+		}
+		return nullptr;
+	}
+
+	/** 结构等价：类型、bReverse 相同，叶子 Condition 内容相同，孩子逐个等价（含 null 位置） */
+	bool ArePredicatesEquivalent(const UDamagePredicate* A, const UDamagePredicate* B)
+	{
+		if (A == B) return true;
+		if (!A || !B || A->GetClass() != B->GetClass() || A->bReverse != B->bReverse) return false;
+
+		if (const UDamagePredicate_Single* SingleA = Cast<UDamagePredicate_Single>(A))
+		{
+			return AreObjectsIdentical(SingleA->Condition, CastChecked<UDamagePredicate_Single>(B)->Condition);
+		}
+
+		const TArray<TObjectPtr<UDamagePredicate>>* ChildrenA = GetChildPredicates(A);
+		const TArray<TObjectPtr<UDamagePredicate>>* ChildrenB = GetChildPredicates(B);
+		if (!ChildrenA || !ChildrenB)
+		{
+			// 未知谓词子类只按身份比较
+			return false;
+		}
+		if (ChildrenA->Num() != ChildrenB->Num()) return false;
+
+		for (int32 i = 0; i < ChildrenA->Num(); ++i)
+		{
+			if (!ArePredicatesEquivalent((*ChildrenA)[i], (*ChildrenB)[i]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/** 可共享的复合节点：AND / OR 且至少两个非空孩子（更小的节点编译后只有一两条指令，共享无收益） */
+	bool IsShareableComposite(const UDamagePredicate* Node)
+	{
+		const TArray<TObjectPtr<UDamagePredicate>>* Children = GetChildPredicates(Node);
+		if (!Children) return false;
+
+		int32 NumValid = 0;
+		for (const auto& Child : *Children)
+		{
+			NumValid += Child ? 1 : 0;
+		}
+		return NumValid >= 2;
+	}
+}
+
+uint32 FCompiledDamagePipeline::HashObjectContent(const UObject* Object, bool bStable)
+{
+	if (!Object)
+	{
+		return 0;
+	}
+
+	// 指针与 FName 的哈希只在本进程内有效；稳定哈希一律经文本
+	uint32 Hash = bStable ? GetTypeHash(Object->GetClass()->GetPathName()) : PointerHash(Object->GetClass());
+	for (TFieldIterator<FProperty> It(Object->GetClass()); It; ++It)
+	{
+		const FProperty* Property = *It;
+		const void* Value = Property->ContainerPtrToValuePtr<void>(Object);
+		if (!bStable && Property->HasAllPropertyFlags(CPF_HasGetValueTypeHash))
+		{
+			Hash = HashCombineFast(Hash, Property->GetValueTypeHash(Value));
+		}
+		else
+		{
+			FString Text;
+			Property->ExportTextItem_Direct(Text, Value, nullptr, nullptr, PPF_None);
+			Hash = HashCombineFast(Hash, GetTypeHash(Text));
+		}
+	}
+	return Hash;
+}
+
+uint32 FCompiledDamagePipeline::HashPredicateContent(const UDamagePredicate* Node, bool bStable)
+{
+	if (!Node)
+	{
+		return 0;
+	}
+
+	const uint32 ClassHash = bStable ? GetTypeHash(Node->GetClass()->GetPathName()) : PointerHash(Node->GetClass());
+	uint32 Hash = HashCombineFast(ClassHash, GetTypeHash(Node->bReverse));
+	if (const UDamagePredicate_Single* Single = Cast<UDamagePredicate_Single>(Node))
+	{
+		Hash = HashCombineFast(Hash, HashObjectContent(Single->Condition, bStable));
+	}
+	else if (const TArray<TObjectPtr<UDamagePredicate>>* Children = GetChildPredicates(Node))
+	{
+		for (const auto& Child : *Children)
+		{
+			Hash = HashCombineFast(Hash, HashPredicateContent(Child, bStable));
+		}
+	}
+	return Hash;
+}
+
+uint32 FCompiledDamagePipeline::HashOperationDeclaration(const UClass* OperationClass, bool bStable)
+{
+	const UDamageOperationBase* CDO = OperationClass ? Cast<UDamageOperationBase>(OperationClass->GetDefaultObject()) : nullptr;
+	if (!CDO)
+	{
+		return 0;
+	}
+
+	auto HashType = [bStable](const UScriptStruct* Type) -> uint32
+	{
+		return !Type ? 0 : bStable ? GetTypeHash(Type->GetPathName()) : PointerHash(Type);
+	};
+
+	uint32 Hash = bStable ? GetTypeHash(OperationClass->GetPathName()) : PointerHash(OperationClass);
+	Hash = HashCombineFast(Hash, HashType(CDO->GetEffectType()));
+	for (const UScriptStruct* Type : CDO->GetConsumedEffectTypes())
+	{
+		Hash = HashCombineFast(Hash, HashType(Type));
+	}
+	return Hash;
+}
+
+int32 FCompiledDamagePipeline::FindOrAddCondition(const UDamageCondition* Condition)
+{
+	const uint32 Hash = HashObjectContent(Condition);
+	for (auto It = ConditionIndexByHash.CreateConstKeyIterator(Hash); It; ++It)
+	{
+		if (AreObjectsIdentical(Conditions[It.Value()], Condition))
+		{
+			return It.Value();
+		}
+	}
+
+	// 编译期即解析分发方式：GetEvaluationCost 据此估计开销
+	Condition->ResolveNativeDispatch();
+	ConditionHashes.Add(Hash);
+	const int32 Index = Conditions.Add(Condition);
+	ConditionIndexByHash.Add(Hash, Index);
+	return Index;
+}
+
+int32 FCompiledDamagePipeline::FindSubexpr(const UDamagePredicate* Node) const
+{
+	if (Subexprs.Num() == 0)
+	{
+		return INDEX_NONE;
+	}
+
+	const uint32 Hash = HashPredicateContent(Node);
+	for (int32 Index = 0; Index < Subexprs.Num(); ++Index)
+	{
+		const FDamagePredicateSubexpr& Subexpr = Subexprs[Index];
+		if (Subexpr.Hash == Hash && ArePredicatesEquivalent(Subexpr.Representative.Get(), Node))
+		{
+			return Index;
+		}
+	}
+	return INDEX_NONE;
+}
+
+// ============================================================================
+// 公共子表达式
+// ============================================================================
+//
+// 各 Rule 的谓词树中结构相同的 AND / OR 子树（如 Hurt 与 Collapse 共有的 NOT(IsGuard AND GuardSuccess)）
+// 编译为一份 Body，Rule 中改为 Subexpr 引用；叶子 Condition 由 FindOrAddCondition 按内容去重。
+// 同一次执行内，共享项首次求值后记入 FDamagePredicateMemo，后续引用直接取值（见 ComputeMemoSafety）。
+
+void FCompiledDamagePipeline::ShareCommonPredicates(TConstArrayView<const UDamagePredicate*> Roots)
+{
+	struct FCandidate
+	{
+		const UDamagePredicate* Representative = nullptr;
+		uint32 Hash = 0;
+		int32 Count = 0;
+		int32 Height = 0;
+	};
+
+	TArray<FCandidate> Candidates;
+	TMap<uint32, TArray<int32, TInlineAllocator<1>>> CandidatesByHash;
+
+	// 后序遍历：返回子树高度，顺带统计每个等价类的出现次数
+	auto Visit = [&](auto& Self, const UDamagePredicate* Node) -> int32
+	{
+		const TArray<TObjectPtr<UDamagePredicate>>* Children = Node ? GetChildPredicates(Node) : nullptr;
+		if (!Children)
+		{
+			return 0;
+		}
+
+		int32 Height = 0;
+		for (const auto& Child : *Children)
+		{
+			Height = FMath::Max(Height, Self(Self, Child.Get()));
+		}
+		++Height;
+
+		if (IsShareableComposite(Node))
+		{
+			const uint32 Hash = HashPredicateContent(Node);
+			auto& Bucket = CandidatesByHash.FindOrAdd(Hash);
+			int32* Existing = Bucket.FindByPredicate([&](int32 Index)
+			{
+				return ArePredicatesEquivalent(Candidates[Index].Representative, Node);
+			});
+			if (Existing)
+			{
+				++Candidates[*Existing].Count;
+			}
+			else
+			{
+				Bucket.Add(Candidates.Add(FCandidate{ Node, Hash, 1, Height }));
+			}
+		}
+		return Height;
+	};
+
+	for (const UDamagePredicate* Root : Roots)
+	{
+		Visit(Visit, Root);
+	}
+
+	Candidates.RemoveAll([](const FCandidate& Candidate) { return Candidate.Count < 2; });
+	if (Candidates.Num() == 0)
+	{
+		return;
+	}
+
+	// 自底向上发射：外层 Body 中的内层共享子树已登记，直接引用
+	Algo::StableSortBy(Candidates, &FCandidate::Height);
+	for (const FCandidate& Candidate : Candidates)
+	{
+		const FPredicateTerm Body = LowerPredicate(Candidate.Representative, /*bNegate=*/false, /*bAllowShared=*/false);
+
+		FDamagePredicateSubexpr Subexpr;
+		Subexpr.Start = PredicateCode.Num();
+		EmitTerm(Body);
+		Subexpr.Num = PredicateCode.Num() - Subexpr.Start;
+		Subexpr.Cost = Body.Cost;
+		ThreadJumps(Subexpr.Start, Subexpr.Num);
+
+		Subexpr.Hash = Candidate.Hash;
+		Subexpr.Representative = Candidate.Representative;
+		Subexprs.Add(Subexpr);
+	}
+}
+
+// ============================================================================
+// 记忆安全性
+// ============================================================================
+//
+// 记忆项 E 在一次执行内首次被求值于 Rule FirstUse(E)。若 E（含其 Body 中的各项）读取的每个 Slot
+// 的最后一个写者都排在 FirstUse(E) 之前，则之后各处看到的输入不变，复用首次结果与重新求值等价。
+// 上下文 Condition 不读 Slot，但读取的 Game 扩展字段可被 Operation（拿到可变的 UDamageContext）在 Rule 之间修改：
+// 它们及包含它们的 Subexpr 不记忆，每次照常求值（与逐 Rule 求值的语义一致）。
+
+void FCompiledDamagePipeline::ComputeMemoSafety()
+{
+	const int32 NumConditions = Conditions.Num();
+	const int32 NumEntries = NumMemoEntries();
+
+	// 每项读取的 Slot（Subexpr 的 Body 只引用下标更小的 Subexpr，顺序计算即可）
+	TArray<TArray<int32, TInlineAllocator<4>>> EntrySlots;
+	EntrySlots.SetNum(NumEntries);
+	TBitArray<> ReadsContext(false, NumEntries);
+	for (int32 Index = 0; Index < NumConditions; ++Index)
+	{
+		const int32 Slot = FindEffectSlot(Conditions[Index]->GetEffectType());
+		if (Slot != INDEX_NONE)
+		{
+			EntrySlots[Index].Add(Slot);
+		}
+		ReadsContext[Index] = Conditions[Index]->IsA<UDamageCondition_Context>();
+	}
+	for (int32 SubexprIndex = 0; SubexprIndex < Subexprs.Num(); ++SubexprIndex)
+	{
+		const FDamagePredicateSubexpr& Subexpr = Subexprs[SubexprIndex];
+		auto& Slots = EntrySlots[NumConditions + SubexprIndex];
+		for (int32 PC = Subexpr.Start; PC < Subexpr.Start + Subexpr.Num; ++PC)
+		{
+			const FDamagePredicateInstr& Instr = PredicateCode[PC];
+			const int32 Entry = Instr.Op == EDamagePredicateOp::Condition ? Instr.Operand
+				: Instr.Op == EDamagePredicateOp::Subexpr ? NumConditions + Instr.Operand
+				: INDEX_NONE;
+			if (Entry != INDEX_NONE)
+			{
+				for (int32 Slot : EntrySlots[Entry])
+				{
+					Slots.AddUnique(Slot);
+				}
+				ReadsContext[NumConditions + SubexprIndex] = ReadsContext[NumConditions + SubexprIndex] || ReadsContext[Entry];
+			}
+		}
+	}
+
+	TArray<int32> LastWriter;
+	LastWriter.Init(INDEX_NONE, Layout->Num());
+	for (int32 RuleIndex = 0; RuleIndex < Rules.Num(); ++RuleIndex)
+	{
+		if (Rules[RuleIndex].Operation && Rules[RuleIndex].EffectSlot != INDEX_NONE)
+		{
+			LastWriter[Rules[RuleIndex].EffectSlot] = RuleIndex;
+		}
+	}
+
+	// Rules 按执行顺序遍历，首次标记即最早使用；已标记的 Subexpr 不再深入
+	TArray<int32> FirstUse;
+	FirstUse.Init(MAX_int32, NumEntries);
+	auto MarkUses = [&](auto& Self, int32 Start, int32 Num, int32 RuleIndex) -> void
+	{
+		for (int32 PC = Start; PC < Start + Num; ++PC)
+		{
+			const FDamagePredicateInstr& Instr = PredicateCode[PC];
+			if (Instr.Op == EDamagePredicateOp::Condition)
+			{
+				FirstUse[Instr.Operand] = FMath::Min(FirstUse[Instr.Operand], RuleIndex);
+			}
+			else if (Instr.Op == EDamagePredicateOp::Subexpr && FirstUse[NumConditions + Instr.Operand] > RuleIndex)
+			{
+				FirstUse[NumConditions + Instr.Operand] = RuleIndex;
+				const FDamagePredicateSubexpr& Subexpr = Subexprs[Instr.Operand];
+				Self(Self, Subexpr.Start, Subexpr.Num, RuleIndex);
+			}
+		}
+	};
+	for (int32 RuleIndex = 0; RuleIndex < Rules.Num(); ++RuleIndex)
+	{
+		MarkUses(MarkUses, Rules[RuleIndex].PredicateStart, Rules[RuleIndex].PredicateNum, RuleIndex);
+	}
+
+	MemoSafe.Init(false, NumEntries);
+	int32 NumSafe = 0;
+	for (int32 Entry = 0; Entry < NumEntries; ++Entry)
+	{
+		const bool bSafe = !ReadsContext[Entry] && !EntrySlots[Entry].ContainsByPredicate([&](int32 Slot)
+		{
+			return LastWriter[Slot] >= FirstUse[Entry];
+		});
+		MemoSafe[Entry] = bSafe;
+		NumSafe += bSafe ? 1 : 0;
+	}
+
+	UE_LOG(LogSagaStats, Verbose, TEXT("编译计划: %d 个去重 Condition，%d 个共享子谓词，%d 项可记忆"),
+		NumConditions, Subexprs.Num(), NumSafe);
+}
+
+// ============================================================================
+// 谓词编译：UDamagePredicate 树 → 规范化谓词项 → 短路跳转字节码
+// ============================================================================
+//
+// 语义与 UDamagePredicate::EvaluatePredicate 逐节点对齐：
+//   Single：Condition 为空 → false
+//   And/Or：Predicates 为空 → false；跳过 null 孩子；孩子全为 null → And 为 true、Or 为 false
+//   bReverse：对本节点结果取反
+//
+// 规范化（只作用于编译产物，编辑器中的谓词树保持原样）：
+//   NOT 下推：NOT(A AND B) = (NOT A) OR (NOT B)，NOT(A OR B) = (NOT A) AND (NOT B)；嵌套 bReverse 就此相消
+//   展平：AND 的 AND 孩子、OR 的 OR 孩子并入本层
+//   常量折叠：AND 去掉 true 孩子、遇 false 整体为 false（OR 对偶）；同一叶子重复出现只留一个，与其取反同时出现则整体为常量
+//   退化节点：只剩一个孩子的 AND / OR 由孩子替代；去空后的 AND 为 true、OR 为 false（作者写下的空节点仍按上面的 false 处理）
+//   开销排序：孩子按估计开销升序（同开销保持作者顺序），廉价的判定先行、先短路
+// 以上变换依赖 Condition 无副作用（求值次数与次序不影响结果）。
+// 共享子谓词的 Body 不随祖先取反，祖先的 NOT 落在 Subexpr 指令的 bNegate 上。
+
+struct FCompiledDamagePipeline::FPredicateTerm
+{
+	enum class EKind : uint8
+	{
+		Const,
+		Condition,
+		Subexpr,
+		And,
+		Or,
+	};
+
+	EKind Kind = EKind::Const;
+
+	/** Const：值；Condition / Subexpr：取反 */
+	bool bValue = false;
+
+	/** Condition：Conditions 下标；Subexpr：Subexprs 下标 */
+	int32 Operand = INDEX_NONE;
+
+	/** 估计开销（叶子取 UDamageCondition::GetEvaluationCost，复合项为孩子之和） */
+	float Cost = 0.f;
+
+	TArray<FPredicateTerm> Children;
+
+	static FPredicateTerm MakeConst(bool bInValue)
+	{
+		FPredicateTerm Term;
+		Term.bValue = bInValue;
+		return Term;
+	}
+
+	bool IsConst(bool bInValue) const { return Kind == EKind::Const && bValue == bInValue; }
+	bool IsLeaf() const { return Kind == EKind::Condition || Kind == EKind::Subexpr; }
+};
+
+void FCompiledDamagePipeline::CompilePredicate(const UDamagePredicate* Root, FCompiledDamageRule& Into)
+{
+	Into.PredicateStart = PredicateCode.Num();
+	if (Root)
+	{
+		// 恒真谓词不发射任何指令（PredicateNum == 0 即无条件执行）
+		const FPredicateTerm Term = LowerPredicate(Root, /*bNegate=*/false, /*bAllowShared=*/true);
+		if (!Term.IsConst(true))
+		{
+			EmitTerm(Term);
+		}
+	}
+	Into.PredicateNum = PredicateCode.Num() - Into.PredicateStart;
+	ThreadJumps(Into.PredicateStart, Into.PredicateNum);
+}
+
+FCompiledDamagePipeline::FPredicateTerm FCompiledDamagePipeline::LowerPredicate(const UDamagePredicate* Node, bool bNegate, bool bAllowShared)
+{
+	using EKind = FPredicateTerm::EKind;
+
+	if (bAllowShared)
+	{
+		const int32 SubexprIndex = IsShareableComposite(Node) ? FindSubexpr(Node) : INDEX_NONE;
+		if (SubexprIndex != INDEX_NONE)
+		{
+			FPredicateTerm Term;
+			Term.Kind = EKind::Subexpr;
+			Term.bValue = bNegate;
+			Term.Operand = SubexprIndex;
+			Term.Cost = Subexprs[SubexprIndex].Cost;
+			return Term;
+		}
+	}
+
+	const bool bEffectiveNegate = bNegate != Node->bReverse;
+
+	if (const UDamagePredicate_Single* Single = Cast<UDamagePredicate_Single>(Node))
+	{
+		if (!Single->Condition)
+		{
+			return FPredicateTerm::MakeConst(bEffectiveNegate);
+		}
+
+		FPredicateTerm Term;
+		Term.Kind = EKind::Condition;
+		Term.bValue = bEffectiveNegate;
+		Term.Operand = FindOrAddCondition(Single->Condition.Get());
+		Term.Cost = Conditions[Term.Operand]->GetEvaluationCost();
+		return Term;
+	}
+
+	const TArray<TObjectPtr<UDamagePredicate>>* Children = GetChildPredicates(Node);
+	if (!Children || Children->Num() == 0)
+	{
+		// 未知谓词子类 / 空集合：与递归版本一致视为 false
+		return FPredicateTerm::MakeConst(bEffectiveNegate);
+	}
+
+	// De Morgan：取反后 AND ↔ OR 互换
+	const bool bIsAnd = Node->IsA<UDamagePredicate_And>();
+	FPredicateTerm Term;
+	Term.Kind = bIsAnd != bEffectiveNegate ? EKind::And : EKind::Or;
+	for (const auto& Child : *Children)
+	{
+		if (Child)
+		{
+			Term.Children.Add(LowerPredicate(Child, bEffectiveNegate, /*bAllowShared=*/true));
+		}
+	}
+
+	if (Term.Children.Num() == 0)
+	{
+		return FPredicateTerm::MakeConst(bIsAnd != bEffectiveNegate);
+	}
+
+	SimplifyTerm(Term);
+	return Term;
+}
+
+void FCompiledDamagePipeline::SimplifyTerm(FPredicateTerm& Term)
+{
+	using EKind = FPredicateTerm::EKind;
+
+	// AND：单位元 true、吸收元 false；OR 对偶
+	const bool bIdentity = Term.Kind == EKind::And;
+	const bool bAbsorbing = !bIdentity;
+
+	TArray<FPredicateTerm> Flat;
+	Flat.Reserve(Term.Children.Num());
+	for (FPredicateTerm& Child : Term.Children)
+	{
+		if (Child.Kind == Term.Kind)
+		{
+			// 孩子已规范化，其孩子不会再是同类节点或常量
+			Flat.Append(MoveTemp(Child.Children));
+		}
+		else
+		{
+			Flat.Add(MoveTemp(Child));
+		}
+	}
+
+	Term.Children.Reset();
+	Term.Cost = 0.f;
+	for (FPredicateTerm& Child : Flat)
+	{
+		if (Child.IsConst(bIdentity))
+		{
+			continue;
+		}
+		if (Child.IsConst(bAbsorbing))
+		{
+			Term = FPredicateTerm::MakeConst(bAbsorbing);
+			return;
+		}
+
+		if (Child.IsLeaf())
+		{
+			const FPredicateTerm* Same = Term.Children.FindByPredicate([&Child](const FPredicateTerm& Other)
+			{
+				return Other.Kind == Child.Kind && Other.Operand == Child.Operand;
+			});
+			if (Same && Same->bValue == Child.bValue)
+			{
+				continue;
+			}
+			if (Same)
+			{
+				// X AND NOT X = false，X OR NOT X = true
+				Term = FPredicateTerm::MakeConst(bAbsorbing);
+				return;
+			}
+		}
+
+		Term.Cost += Child.Cost;
+		Term.Children.Add(MoveTemp(Child));
+	}
+
+	if (Term.Children.Num() == 0)
+	{
+		Term = FPredicateTerm::MakeConst(bIdentity);
+		return;
+	}
+	if (Term.Children.Num() == 1)
+	{
+		FPredicateTerm Only = MoveTemp(Term.Children[0]);
+		Term = MoveTemp(Only);
+		return;
+	}
+
+	Algo::StableSortBy(Term.Children, &FPredicateTerm::Cost);
+}
+
+void FCompiledDamagePipeline::EmitTerm(const FPredicateTerm& Term)
+{
+	using EKind = FPredicateTerm::EKind;
+
+	if (Term.Kind == EKind::Const)
+	{
+		FDamagePredicateInstr& Instr = PredicateCode.AddDefaulted_GetRef();
+		Instr.Op = EDamagePredicateOp::Const;
+		Instr.Operand = Term.bValue ? 1 : 0;
+		return;
+	}
+	if (Term.IsLeaf())
+	{
+		FDamagePredicateInstr& Instr = PredicateCode.AddDefaulted_GetRef();
+		Instr.Op = Term.Kind == EKind::Condition ? EDamagePredicateOp::Condition : EDamagePredicateOp::Subexpr;
+		Instr.bNegate = Term.bValue;
+		Instr.Operand = Term.Operand;
+		return;
+	}
+
+	// AND 遇 false 短路，OR 遇 true 短路
+	const EDamagePredicateOp JumpOp = Term.Kind == EKind::And ? EDamagePredicateOp::JumpIfFalse : EDamagePredicateOp::JumpIfTrue;
+
+	TArray<int32, TInlineAllocator<8>> PendingJumps;
+	for (int32 i = 0; i < Term.Children.Num(); ++i)
+	{
+		EmitTerm(Term.Children[i]);
+		if (i + 1 < Term.Children.Num())
+		{
+			FDamagePredicateInstr& Jump = PredicateCode.AddDefaulted_GetRef();
+			Jump.Op = JumpOp;
+			PendingJumps.Add(PredicateCode.Num() - 1);
+		}
+	}
+
+	// 回填：所有短路跳转指向本项末尾
+	const int32 End = PredicateCode.Num();
+	for (int32 JumpIndex : PendingJumps)
+	{
+		PredicateCode[JumpIndex].Operand = End - (JumpIndex + 1);
+	}
+}
+
+void FCompiledDamagePipeline::ThreadJumps(int32 Start, int32 Num)
+{
+	auto IsJump = [](EDamagePredicateOp Op)
+	{
+		return Op == EDamagePredicateOp::JumpIfFalse || Op == EDamagePredicateOp::JumpIfTrue;
+	};
+
+	// 只有前向跳转：逆序处理，目标处的跳转已穿透完毕
+	for (int32 Local = Num - 1; Local >= 0; --Local)
+	{
+		FDamagePredicateInstr& Jump = PredicateCode[Start + Local];
+		if (!IsJump(Jump.Op)) continue;
+
+		int32 Target = Local + 1 + Jump.Operand;
+		while (Target < Num && IsJump(PredicateCode[Start + Target].Op))
+		{
+			const FDamagePredicateInstr& Next = PredicateCode[Start + Target];
+			// 同向：Acc 未变，必然继续跳；反向：必然不跳，直接落到下一条
+			Target = (Next.Op == Jump.Op) ? Target + 1 + Next.Operand : Target + 1;
+		}
+		Jump.Operand = Target - (Local + 1);
+	}
+}
+
+// ============================================================================
+// 谓词解释执行
+// ============================================================================
+
+bool FCompiledDamagePipeline::EvaluatePredicate(const FCompiledDamageRule& Rule, const FDamageContext* Context, FDamagePredicateMemo* Memo) const
+{
+	if (Rule.PredicateNum == 0) return true;
+
+	checkSlow(!Memo || Memo->Known.Num() == NumMemoEntries());
+	return EvaluateCode(Rule.PredicateStart, Rule.PredicateNum, Context, Memo);
+}
+
+bool FCompiledDamagePipeline::EvaluateCode(int32 Start, int32 Num, const FDamageContext* Context, FDamagePredicateMemo* Memo) const
+{
+	const FDamagePredicateInstr* Code = PredicateCode.GetData() + Start;
+	bool bAcc = false;
+
+	// 记忆项：可安全复用时查 / 填 Memo，否则照常求值
+	auto EvaluateEntry = [this, Memo](int32 Entry, auto&& Evaluate) -> bool
+	{
+		if (!Memo || !MemoSafe[Entry])
+		{
+			return Evaluate();
+		}
+		if (!Memo->Known[Entry])
+		{
+			Memo->Value[Entry] = Evaluate();
+			Memo->Known[Entry] = true;
+		}
+		return Memo->Value[Entry];
+	};
+
+	for (int32 PC = 0; PC < Num; ++PC)
+	{
+		const FDamagePredicateInstr& Instr = Code[PC];
+		switch (Instr.Op)
+		{
+		case EDamagePredicateOp::Const:
+			bAcc = Instr.Operand != 0;
+			break;
+		case EDamagePredicateOp::Condition:
+			bAcc = EvaluateEntry(Instr.Operand, [&]()
+			{
+				return Conditions[Instr.Operand]->EvaluateCondition(Context);
+			}) != Instr.bNegate;
+			break;
+		case EDamagePredicateOp::Subexpr:
+			bAcc = EvaluateEntry(Conditions.Num() + Instr.Operand, [&]()
+			{
+				const FDamagePredicateSubexpr& Subexpr = Subexprs[Instr.Operand];
+				return EvaluateCode(Subexpr.Start, Subexpr.Num, Context, Memo);
+			}) != Instr.bNegate;
+			break;
+		case EDamagePredicateOp::JumpIfFalse:
+			if (!bAcc) PC += Instr.Operand;
+			break;
+		case EDamagePredicateOp::JumpIfTrue:
+			if (bAcc) PC += Instr.Operand;
+			break;
+		}
+	}
+
+	return bAcc;
+}
@@ -6,8 +6,20 @@
 
 // DamageCondition_Context.cpp — 基于 Context 的条件原子实现（直接 dispatch）
 #include "DamagePipeline/DamageCondition_Context.h"
+#include "DamagePipeline/DamageContext.h"
 
-bool UDamageCondition_Context::EvaluateCondition(const UDamageContext* Context) const
+bool UDamageCondition_Context::EvaluateCondition(const FDamageContext* Context) const
 {
-	return Evaluate(Context);
+	// 原生类直调实现，省去 BlueprintNativeEvent thunk；蓝图事件需要 UDamageContext，裸 Context 借用代理（FDamageScriptContext）
+	if (bScriptEvaluate)
+	{
+		const FDamageScriptContext ScriptContext(Context);
+		return Evaluate(ScriptContext.Get());
+	}
+	return Evaluate_Implementation(Context ? Context->GetOwner() : nullptr);
+}
+
+void UDamageCondition_Context::ResolveNativeDispatch() const
+{
+	bScriptEvaluate = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UDamageCondition_Context, Evaluate));
 }
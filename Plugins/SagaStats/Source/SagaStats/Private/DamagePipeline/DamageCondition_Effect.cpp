@@ -8,15 +8,44 @@
 #include "DamagePipeline/DamageCondition_Effect.h"
 #include "DamagePipeline/DamageContext.h"
 
-bool UDamageCondition_Effect::EvaluateCondition(const UDamageContext* Context) const
+bool UDamageCondition_Effect::EvaluateCondition(const FDamageContext* Context) const
 {
-	FInstancedStruct EffectValue;
+	FConstStructView EffectView;
 	UScriptStruct* Type = GetEffectType();
 	if (Context && Type)
 	{
-		// Context 是 friend 关系，能调 protected GetEffectByType
-		EffectValue = Context->GetEffectByType(Type);
+		// Context 是 friend 关系，能调 protected GetEffectViewByType
+		EffectView = Context->GetEffectViewByType(Type);
+	}
+
+	return EvaluateView(Context, EffectView);
+}
+
+bool UDamageCondition_Effect::EvaluateView(const FDamageContext* Context, FConstStructView InEffect) const
+{
+	// 蓝图事件签名为 const FInstancedStruct&：桥接需要一份拥有型拷贝
+	FInstancedStruct EffectValue;
+	if (InEffect.IsValid())
+	{
+		EffectValue.InitializeAs(InEffect.GetScriptStruct(), InEffect.GetMemory());
 	}
 
-	return Evaluate(Context, EffectValue);
+	// 原生类（只实现 Evaluate_Implementation）直调实现，省去 BlueprintNativeEvent thunk；
+	// 蓝图事件需要 UDamageContext，裸 Context 借用代理（FDamageScriptContext）
+	if (bScriptEvaluate)
+	{
+		const FDamageScriptContext ScriptContext(Context);
+		return Evaluate(ScriptContext.Get(), EffectValue);
+	}
+	return Evaluate_Implementation(Context ? Context->GetOwner() : nullptr, EffectValue);
+}
+
+bool UDamageCondition_Effect::EvaluateView(const UDamageContext* Context, FConstStructView InEffect) const
+{
+	return EvaluateView(Context ? &Context->GetNativeContext() : nullptr, InEffect);
+}
+
+void UDamageCondition_Effect::ResolveNativeDispatch() const
+{
+	bScriptEvaluate = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UDamageCondition_Effect, Evaluate));
 }
@@ -4,55 +4,555 @@
 * Description:  SagaStats offers modular damage process and meter systems to support adaptable status management
 ****************************************************************************************************************/
 
-// DamageContext.cpp — 统一存储：所有 Effect 以 UScriptStruct* 为 key
+// DamageContext.cpp — 统一存储：按 Pipeline 布局分配的稠密 Slot + 布局外类型的 ExtraEffects；UDamageContext 转发
 #include "DamagePipeline/DamageContext.h"
 #include "SagaStatsLog.h"
+#include <atomic>
 
 // ============================================================================
-// C++ 内部 API
+// FDamageEffectLayout
 // ============================================================================
 
-void UDamageContext::SetEffectByType(const FInstancedStruct& Value)
+FDamageEffectLayout::~FDamageEffectLayout()
+{
+	if (DefaultArena)
+	{
+		for (int32 Slot = 0; Slot < SlotTypes.Num(); ++Slot)
+		{
+			SlotTypes[Slot]->DestroyStruct(DefaultArena + SlotOffsets[Slot]);
+		}
+		FMemory::Free(DefaultArena);
+	}
+}
+
+int32 FDamageEffectLayout::FindOrAddSlot(UScriptStruct* EffectType)
+{
+	if (!EffectType) return INDEX_NONE;
+	check(!bFinalized);
+
+	if (const int32* Found = SlotByType.Find(EffectType))
+	{
+		return *Found;
+	}
+
+	const int32 Slot = SlotTypes.Add(EffectType);
+	SlotByType.Add(EffectType, Slot);
+	return Slot;
+}
+
+void FDamageEffectLayout::Finalize()
+{
+	if (bFinalized) return;
+	bFinalized = true;
+
+	// 按 Slot 顺序紧密排布，每个 Slot 按自身对齐
+	SlotOffsets.SetNumUninitialized(SlotTypes.Num());
+	int32 Offset = 0;
+	for (int32 Slot = 0; Slot < SlotTypes.Num(); ++Slot)
+	{
+		const UScriptStruct* Type = SlotTypes[Slot];
+		const int32 Alignment = FMath::Max(Type->GetMinAlignment(), 1);
+		Offset = Align(Offset, Alignment);
+		SlotOffsets[Slot] = Offset;
+		Offset += Type->GetStructureSize();
+		ArenaAlignment = FMath::Max(ArenaAlignment, Alignment);
+	}
+	ArenaSize = Offset;
+
+	if (ArenaSize > 0)
+	{
+		DefaultArena = static_cast<uint8*>(FMemory::Malloc(ArenaSize, ArenaAlignment));
+		for (int32 Slot = 0; Slot < SlotTypes.Num(); ++Slot)
+		{
+			SlotTypes[Slot]->InitializeStruct(DefaultArena + SlotOffsets[Slot]);
+		}
+	}
+}
+
+// ============================================================================
+// FDamageContext：C++ 内部 API
+// ============================================================================
+
+void FDamageContext::SetEffectByType(const FInstancedStruct& Value)
 {
 	if (Value.IsValid() && Value.GetScriptStruct())
 	{
-		DamageEffects.Add(const_cast<UScriptStruct*>(Value.GetScriptStruct()), Value);
+		SetEffectMemory(Value.GetScriptStruct(), Value.GetMemory());
+	}
+}
+
+FInstancedStruct FDamageContext::GetEffectByType(UScriptStruct* EffectType) const
+{
+	FInstancedStruct Result;
+	if (const void* Memory = FindEffectMemory(EffectType))
+	{
+		Result.InitializeAs(EffectType, static_cast<const uint8*>(Memory));
+	}
+	return Result;
+}
+
+FConstStructView FDamageContext::GetEffectViewByType(const UScriptStruct* EffectType) const
+{
+	if (const void* Memory = FindEffectMemory(EffectType))
+	{
+		return FConstStructView(EffectType, static_cast<const uint8*>(Memory));
+	}
+	return FConstStructView();
+}
+
+bool FDamageContext::HasEffectByType(UScriptStruct* EffectType) const
+{
+	return FindEffectMemory(EffectType) != nullptr;
+}
+
+TArray<FConstStructView> FDamageContext::GetAllDamageEffects() const
+{
+	TArray<FConstStructView> Result;
+	if (!Parent)
+	{
+		for (TConstSetBitIterator<> It(PresentSlots); It; ++It)
+		{
+			Result.Add(GetEffectViewBySlot(It.GetIndex()));
+		}
+		for (const auto& Pair : ExtraEffects)
+		{
+			Result.Add(FConstStructView(Pair.Value.GetScriptStruct(), Pair.Value.GetMemory()));
+		}
+		return Result;
+	}
+
+	// 分叉：Slot 逐个按可见值解析；布局外类型沿分叉链收集，只保留未被更近一层遮蔽的那份
+	for (int32 Slot = 0; Slot < PresentSlots.Num(); ++Slot)
+	{
+		const FConstStructView View = GetEffectViewBySlot(Slot);
+		if (View.IsValid())
+		{
+			Result.Add(View);
+		}
+	}
+	for (const FDamageContext* Source = this; Source; Source = Source->Parent)
+	{
+		for (const auto& Pair : Source->ExtraEffects)
+		{
+			if (FindEffectMemory(Pair.Key) == Pair.Value.GetMemory())
+			{
+				Result.Add(FConstStructView(Pair.Value.GetScriptStruct(), Pair.Value.GetMemory()));
+			}
+		}
+	}
+	return Result;
+}
+
+uint32 FDamageContext::HashEffectTypes() const
+{
+	uint32 Hash = 0;
+	for (int32 Slot = 0; Slot < PresentSlots.Num(); ++Slot)
+	{
+		if (Parent ? HasEffectBySlot(Slot) : PresentSlots[Slot])
+		{
+			Hash = HashCombineFast(Hash, GetTypeHash(Layout->SlotTypes[Slot]));
+		}
+	}
+
+	// 布局外类型的遍历次序不固定：按类型求和
+	uint32 ExtraHash = 0;
+	for (const FDamageContext* Source = this; Source; Source = Source->Parent)
+	{
+		for (const auto& Pair : Source->ExtraEffects)
+		{
+			if (Source == this || FindEffectMemory(Pair.Key) == Pair.Value.GetMemory())
+			{
+				ExtraHash += GetTypeHash(Pair.Key);
+			}
+		}
+	}
+	return HashCombineFast(Hash, ExtraHash);
+}
+
+// ============================================================================
+// Slot 存储（Arena）
+// ============================================================================
+
+void FDamageContext::BindLayout(const FDamageEffectLayoutPtr& InLayout)
+{
+	if (Layout == InLayout) return;
+	check(!InLayout || InLayout->IsFinalized());
+	RebindLayout(InLayout);
+}
+
+void FDamageContext::Detach()
+{
+	if (!Parent) return;
+	RebindLayout(Layout);
+}
+
+void FDamageContext::RebindLayout(const FDamageEffectLayoutPtr& InLayout)
+{
+	// 收集现有 Effect（可见的全部：Slot 中存在的 + 布局外的 + 分叉时父 Context 的）
+	// ——只在布局切换时发生，不在每次命中的热路径上
+	TArray<FInstancedStruct> Existing;
+	for (const FConstStructView& View : GetAllDamageEffects())
+	{
+		Existing.Emplace_GetRef().InitializeAs(View.GetScriptStruct(), View.GetMemory());
+	}
+
+	// 脱离父 Context（父 Context 的 Effect 已拷入 Existing）
+	ReleaseArena();
+	ExtraEffects.Reset();
+	Parent = nullptr;
+	OverriddenSlots.Reset();
+
+	Layout = InLayout;
+	const int32 NumSlots = Layout ? Layout->Num() : 0;
+	ConstructedSlots.Init(false, NumSlots);
+	PresentSlots.Init(false, NumSlots);
+
+	// 按新布局重新落位
+	for (FInstancedStruct& Effect : Existing)
+	{
+		SetEffectMemory(Effect.GetScriptStruct(), Effect.GetMemory());
+	}
+}
+
+void FDamageContext::AllocateArena()
+{
+	check(Layout && !EffectArena);
+	EffectArena = static_cast<uint8*>(FMemory::Malloc(FMath::Max(Layout->ArenaSize, 1), Layout->ArenaAlignment));
+}
+
+void FDamageContext::ReleaseArena()
+{
+	if (EffectArena)
+	{
+		for (TConstSetBitIterator<> It(ConstructedSlots); It; ++It)
+		{
+			Layout->SlotTypes[It.GetIndex()]->DestroyStruct(GetSlotMemory(It.GetIndex()));
+		}
+		FMemory::Free(EffectArena);
+		EffectArena = nullptr;
+	}
+	ConstructedSlots.Reset();
+	PresentSlots.Reset();
+}
+
+void FDamageContext::SetEffectBySlot(int32 Slot, const FInstancedStruct& Value)
+{
+	if (Value.IsValid())
+	{
+		SetSlotMemory(Slot, Value.GetMemory());
+	}
+}
+
+FConstStructView FDamageContext::GetEffectViewBySlot(int32 Slot) const
+{
+	if (PresentSlots[Slot])
+	{
+		return FConstStructView(Layout->SlotTypes[Slot], GetSlotMemory(Slot));
 	}
+	if (!Parent || OverriddenSlots[Slot]) return FConstStructView();
+	return Parent->Layout == Layout ? Parent->GetEffectViewBySlot(Slot) : Parent->GetEffectViewByType(Layout->SlotTypes[Slot]);
 }
 
-FInstancedStruct UDamageContext::GetEffectByType(UScriptStruct* EffectType) const
+FStructView FDamageContext::EmplaceEffectBySlot(int32 Slot, FDamageSlotSnapshot* OutSnapshot)
 {
-	if (EffectType)
+	if (OutSnapshot)
 	{
-		if (const FInstancedStruct* Found = DamageEffects.Find(EffectType))
+		OutSnapshot->Value.Reset();
+		if (PresentSlots[Slot])
 		{
-			return *Found;
+			OutSnapshot->Value.InitializeAs(Layout->SlotTypes[Slot], GetSlotMemory(Slot));
 		}
+		OutSnapshot->bOverridden = IsSlotOverridden(Slot);
+	}
+
+	EnsureArena();
+	const UScriptStruct* EffectType = Layout->SlotTypes[Slot];
+	uint8* SlotMemory = GetSlotMemory(Slot);
+	if (ConstructedSlots[Slot])
+	{
+		// 复用中的 Slot：从布局的默认实例拷贝赋值，恢复默认初始化状态
+		EffectType->CopyScriptStruct(SlotMemory, Layout->GetSlotDefault(Slot));
+	}
+	else
+	{
+		EffectType->InitializeStruct(SlotMemory);
+		ConstructedSlots[Slot] = true;
+	}
+	PresentSlots[Slot] = true;
+	if (Parent) OverriddenSlots[Slot] = true;
+	return FStructView(EffectType, SlotMemory);
+}
+
+void FDamageContext::RestoreSlot(int32 Slot, const FDamageSlotSnapshot& Snapshot)
+{
+	if (Snapshot.Value.IsValid())
+	{
+		SetSlotMemory(Slot, Snapshot.Value.GetMemory());
+	}
+	else
+	{
+		PresentSlots[Slot] = false;
+	}
+	if (Parent) OverriddenSlots[Slot] = Snapshot.bOverridden;
+}
+
+void FDamageContext::ConstructAllSlots()
+{
+	if (ConstructedSlots.Num() == 0) return;
+
+	EnsureArena();
+	for (int32 Slot = 0; Slot < ConstructedSlots.Num(); ++Slot)
+	{
+		if (!ConstructedSlots[Slot])
+		{
+			Layout->SlotTypes[Slot]->InitializeStruct(GetSlotMemory(Slot));
+			ConstructedSlots[Slot] = true;
+		}
+	}
+}
+
+void FDamageContext::SetSlotMemory(int32 Slot, const void* Memory)
+{
+	EnsureArena();
+	const UScriptStruct* EffectType = Layout->SlotTypes[Slot];
+	uint8* SlotMemory = GetSlotMemory(Slot);
+	if (!ConstructedSlots[Slot])
+	{
+		EffectType->InitializeStruct(SlotMemory);
+		ConstructedSlots[Slot] = true;
+	}
+	// 已构造：原地拷贝赋值（POD 即 memcpy；容器字段复用已有容量）
+	EffectType->CopyScriptStruct(SlotMemory, Memory);
+	PresentSlots[Slot] = true;
+	if (Parent) OverriddenSlots[Slot] = true;
+}
+
+void FDamageContext::SetEffectMemory(const UScriptStruct* EffectType, const void* Memory)
+{
+	const int32 Slot = Layout ? Layout->FindSlot(EffectType) : INDEX_NONE;
+	if (Slot != INDEX_NONE)
+	{
+		SetSlotMemory(Slot, Memory);
+	}
+	else
+	{
+		ExtraEffects.Add(const_cast<UScriptStruct*>(EffectType),
+			FInstancedStruct()).InitializeAs(EffectType, static_cast<const uint8*>(Memory));
 	}
-	return FInstancedStruct();
 }
 
-bool UDamageContext::HasEffectByType(UScriptStruct* EffectType) const
+const void* FDamageContext::FindEffectMemory(const UScriptStruct* EffectType) const
 {
-	return EffectType && DamageEffects.Contains(EffectType);
+	if (!EffectType) return nullptr;
+
+	const int32 Slot = Layout ? Layout->FindSlot(EffectType) : INDEX_NONE;
+	if (Slot != INDEX_NONE)
+	{
+		return GetEffectViewBySlot(Slot).GetMemory();
+	}
+
+	const FInstancedStruct* Found = ExtraEffects.Find(const_cast<UScriptStruct*>(EffectType));
+	if (Found)
+	{
+		return Found->GetMemory();
+	}
+	return Parent ? Parent->FindEffectMemory(EffectType) : nullptr;
 }
 
 // ============================================================================
-// 生命周期 / 调试
+// FDamageContext：生命周期 / 调试
 // ============================================================================
 
-void UDamageContext::Reset()
+/** 进程内 Context 编号（追踪记录用；池化 / 并行批量下各线程都会构造 Context） */
+static std::atomic<uint32> GNextDamageContextId{ 1 };
+
+FDamageContext::FDamageContext()
+	: ContextId(GNextDamageContextId.fetch_add(1, std::memory_order_relaxed))
+{
+}
+
+FDamageContext::~FDamageContext()
+{
+	ReleaseArena();
+}
+
+FDamageContext::FDamageContext(FDamageContext&& Other)
+	: ContextId(GNextDamageContextId.fetch_add(1, std::memory_order_relaxed))
+{
+	*this = MoveTemp(Other);
+}
+
+FDamageContext& FDamageContext::operator=(FDamageContext&& Other)
+{
+	if (this != &Other)
+	{
+		ReleaseArena();
+		Layout = MoveTemp(Other.Layout);
+		EffectArena = Other.EffectArena;
+		ConstructedSlots = MoveTemp(Other.ConstructedSlots);
+		PresentSlots = MoveTemp(Other.PresentSlots);
+		ExtraEffects = MoveTemp(Other.ExtraEffects);
+		Parent = Other.Parent;
+		OverriddenSlots = MoveTemp(Other.OverriddenSlots);
+
+		// Arena 所有权转移；Owner 与 ContextId 属于对象本身，不随之搬移
+		Other.EffectArena = nullptr;
+		Other.Layout.Reset();
+		Other.ConstructedSlots.Reset();
+		Other.PresentSlots.Reset();
+		Other.ExtraEffects.Reset();
+		Other.Parent = nullptr;
+		Other.OverriddenSlots.Reset();
+	}
+	return *this;
+}
+
+void FDamageContext::Reset()
+{
+	// 只清存在位：Arena 中已构造的 struct 留给下一次命中原地覆写
+	PresentSlots.SetRange(0, PresentSlots.Num(), false);
+	OverriddenSlots.SetRange(0, OverriddenSlots.Num(), false);
+	ExtraEffects.Reset();
+}
+
+FDamageContext FDamageContext::Fork() const
 {
-	DamageEffects.Empty();
+	FDamageContext Child;
+	Child.Parent = this;
+	Child.Layout = Layout;
+
+	// Arena 推迟到子 Context 首次写入时分配
+	const int32 NumSlots = Layout ? Layout->Num() : 0;
+	Child.ConstructedSlots.Init(false, NumSlots);
+	Child.PresentSlots.Init(false, NumSlots);
+	Child.OverriddenSlots.Init(false, NumSlots);
+	return Child;
+}
+
+void FDamageContext::AddReferencedObjects(FReferenceCollector& Collector, const UObject* ReferencingObject)
+{
+	// 已构造但不存在（Reset 后）的 Slot 也上报：其中的引用仍会在下次覆写前保留
+	if (EffectArena)
+	{
+		for (TConstSetBitIterator<> It(ConstructedSlots); It; ++It)
+		{
+			Collector.AddPropertyReferencesWithStructARO(
+				Layout->SlotTypes[It.GetIndex()], GetSlotMemory(It.GetIndex()), ReferencingObject);
+		}
+	}
+
+	// FInstancedStruct 同时上报自身的 ScriptStruct，key 随之保活
+	for (auto& Pair : ExtraEffects)
+	{
+		Collector.AddPropertyReferencesWithStructARO(
+			TBaseStructure<FInstancedStruct>::Get(), &Pair.Value, ReferencingObject);
+	}
 }
 
-FString UDamageContext::DumpToString() const
+FString FDamageContext::DumpToString() const
 {
 	FString Result = TEXT("DamageContext Effects:\n");
-	for (const auto& Pair : DamageEffects)
+	for (const FConstStructView& Effect : GetAllDamageEffects())
 	{
-		FString TypeName = Pair.Key ? Pair.Key->GetName() : TEXT("null");
+		FString TypeName = Effect.GetScriptStruct() ? Effect.GetScriptStruct()->GetName() : TEXT("null");
 		Result += FString::Printf(TEXT("  [%s]\n"), *TypeName);
 	}
 	return Result;
 }
+
+// ============================================================================
+// UDamageContext（蓝图包装）
+// ============================================================================
+
+UDamageContext::UDamageContext()
+{
+	Native.Owner = this;
+}
+
+UDamageContext* UDamageContext::Fork()
+{
+	// 以本对象为模板：Game 扩展字段随之拷贝（Native 不是 UPROPERTY，由 Fork 单独建立）
+	UDamageContext* Child = NewObject<UDamageContext>(GetOuter(), GetClass(), NAME_None, RF_NoFlags, this);
+	Child->Native = Native.Fork();
+	Child->ForkParent = this;
+	return Child;
+}
+
+void UDamageContext::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
+{
+	Super::AddReferencedObjects(InThis, Collector);
+
+	UDamageContext* This = CastChecked<UDamageContext>(InThis);
+	This->Native.AddReferencedObjects(Collector, This);
+}
+
+void UDamageContext::BeginDestroy()
+{
+	Native.ReleaseArena();
+	Native.Layout.Reset();
+	Native.ExtraEffects.Reset();
+	Super::BeginDestroy();
+}
+
+// ============================================================================
+// FDamageScriptContext
+// ============================================================================
+
+namespace
+{
+	/** 蓝图事件的代理池：只在 GameThread 上访问；按嵌套深度后进先出借还 */
+	TArray<UDamageContext*> GScriptContextPool;
+	int32 GScriptContextsInUse = 0;
+}
+
+FDamageScriptContext::FDamageScriptContext(const FDamageContext* Context)
+{
+	if (!Context) return;
+
+	Owner = Context->GetOwner();
+	if (Owner) return;
+
+	// 蓝图事件只在 GameThread 分发（蓝图子类不是线程安全的），静态标志无需同步
+	static bool bWarned = false;
+	if (!bWarned)
+	{
+		bWarned = true;
+		UE_LOG(LogSagaStats, Warning,
+			TEXT("蓝图 Condition / Operation 在没有 UDamageContext 的 FDamageContext 上执行：改传代理 UDamageContext（基类，Game 扩展字段不可用）"));
+	}
+
+	if (IsInGameThread())
+	{
+		if (GScriptContextsInUse == GScriptContextPool.Num())
+		{
+			UDamageContext* NewProxy = NewObject<UDamageContext>(GetTransientPackage());
+			NewProxy->AddToRoot();
+			GScriptContextPool.Add(NewProxy);
+		}
+		PooledProxy = GScriptContextPool[GScriptContextsInUse++];
+		Owner = PooledProxy;
+	}
+	else
+	{
+		TransientProxy.Reset(NewObject<UDamageContext>(GetTransientPackage()));
+		Owner = TransientProxy.Get();
+	}
+
+	// 分叉不分配 Arena（推迟到首次写入），每次借出只是重新指向 Context
+	Owner->GetNativeContext() = Context->Fork();
+}
+
+FDamageScriptContext::~FDamageScriptContext()
+{
+	// 先断开代理对 Context 的透读，Context 之后随时可能销毁
+	if (PooledProxy)
+	{
+		PooledProxy->GetNativeContext() = FDamageContext();
+		check(GScriptContextsInUse > 0 && GScriptContextPool[GScriptContextsInUse - 1] == PooledProxy);
+		--GScriptContextsInUse;
+	}
+	else if (TransientProxy)
+	{
+		TransientProxy->GetNativeContext() = FDamageContext();
+	}
+}
@@ -6,3 +6,70 @@
 
 // DamageOperationBase.cpp
 #include "DamagePipeline/DamageOperationBase.h"
+#include "SagaStatsLog.h"
+
+bool UDamageOperationBase::ExecuteInPlace(FDamageContext* Context, FStructView OutEffect)
+{
+	// 蓝图事件签名为 FInstancedStruct&：以 Slot 当前（默认）值进、结果拷回同一 Slot
+	FInstancedStruct Bridge;
+	Bridge.InitializeAs(OutEffect.GetScriptStruct(), OutEffect.GetMemory());
+
+	// 原生类（只实现 Execute_Implementation）直调实现，省去 BlueprintNativeEvent thunk；
+	// 蓝图事件需要 UDamageContext，裸 Context 由 FDamageScriptContext 借出代理
+	if (bScriptExecute)
+	{
+		const FDamageScriptContext ScriptContext(Context);
+		Execute(ScriptContext.Get(), Bridge);
+	}
+	else
+	{
+		Execute_Implementation(Context ? Context->GetOwner() : nullptr, Bridge);
+	}
+
+	// 校验 OutEffect 类型与声明的 EffectType 一致
+	if (!Bridge.IsValid() || Bridge.GetScriptStruct() != OutEffect.GetScriptStruct())
+	{
+		UE_LOG(LogSagaStats, Error,
+			TEXT("DamageOperation %s: OutEffect 类型不匹配！期望 %s，实际 %s"),
+			*GetClass()->GetName(),
+			*OutEffect.GetScriptStruct()->GetName(),
+			Bridge.IsValid() ? *Bridge.GetScriptStruct()->GetName() : TEXT("invalid"));
+		return false;
+	}
+
+	OutEffect.GetScriptStruct()->CopyScriptStruct(OutEffect.GetMemory(), Bridge.GetMemory());
+	return true;
+}
+
+void UDamageOperationBase::ResolveNativeDispatch()
+{
+	bScriptExecute = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UDamageOperationBase, Execute));
+}
+
+void UDamageOperationBase::ExecuteBatch(TArrayView<FDamageContext* const> Contexts, TArrayView<FStructView> OutEffects)
+{
+	check(Contexts.Num() == OutEffects.Num());
+	for (int32 i = 0; i < Contexts.Num(); ++i)
+	{
+		if (!ExecuteInPlace(Contexts[i], OutEffects[i]))
+		{
+			OutEffects[i] = FStructView();
+		}
+	}
+}
+
+bool UDamageOperationBase::ExecuteInPlace(UDamageContext* Context, FStructView OutEffect)
+{
+	return ExecuteInPlace(Context ? &Context->GetNativeContext() : nullptr, OutEffect);
+}
+
+void UDamageOperationBase::ExecuteBatch(TArrayView<UDamageContext* const> Contexts, TArrayView<FStructView> OutEffects)
+{
+	TArray<FDamageContext*, TInlineAllocator<16>> NativeContexts;
+	NativeContexts.Reserve(Contexts.Num());
+	for (UDamageContext* Context : Contexts)
+	{
+		NativeContexts.Add(Context ? &Context->GetNativeContext() : nullptr);
+	}
+	ExecuteBatch(TArrayView<FDamageContext* const>(NativeContexts), OutEffects);
+}
@@ -9,10 +9,18 @@
 #include "DamagePipeline/DamageCondition.h"
 #include "DamagePipeline/DamageCondition_Effect.h"
 #include "DamagePipeline/DamageContext.h"
+#include "DamagePipeline/DamagePipelineTrace.h"
+#include "DamagePipeline/DamagePipelinePlanCache.h"
 #include "SagaStatsLog.h"
 #include "Misc/FileHelper.h"
 #include "HAL/PlatformFileManager.h"
+#include "Async/ParallelFor.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "HAL/IConsoleManager.h"
+#include "Tasks/Task.h"
 #include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "UObject/ObjectSaveContext.h"
 
 // ============================================================================
 // 编辑器：属性变化时置 bIsBaked = false
@@ -43,141 +51,228 @@ void UDamagePipeline::PostEditChangeChainProperty(FPropertyChangedChainEvent& Pr
 #endif
 
 // ============================================================================
-// 稳定拓扑排序（Kahn 算法 BFS + 原始索引优先队列）
+// 烘焙计划：Cook 时写入，加载后校验恢复
 // ============================================================================
 
-FPipelineSortResult UDamagePipeline::StableTopologicalSort()
+void UDamagePipeline::PreSave(FObjectPreSaveContext ObjectSaveContext)
 {
-	// 从 DamageRules 成员构建非 null 数组
-	TArray<UDamageRule*> Rules;
-	Rules.Reserve(DamageRules.Num());
-	for (const auto& Rule : DamageRules)
-	{
-		if (Rule) Rules.Add(Rule.Get());
-	}
-
-	FPipelineSortResult Result;
-	if (Rules.Num() == 0) return Result;
+	Super::PreSave(ObjectSaveContext);
 
-	// 1. 分配原始索引
-	TMap<UDamageRule*, int32> OriginalIndex;
-	for (int32 i = 0; i < Rules.Num(); i++)
+	CookedPlan.Reset();
+	if (!ObjectSaveContext.IsCooking())
 	{
-		OriginalIndex.Add(Rules[i], i);
+		// 编辑器资产不携带计划：内容随时可能被编辑，保存一份只会过期
+		return;
 	}
 
-	// 2. 构建生产者映射：EffectType -> DamageRule（类型即 key）
-	TMap<UScriptStruct*, UDamageRule*> ProducerMap;
-	for (UDamageRule* Rule : Rules)
+	const FPipelineSortResult Result = Build();
+	if (Result.bHasCycle || !CompiledPlan->bCompiled)
 	{
-		if (!Rule) continue;
-		UScriptStruct* EffectType = Rule->GetProducesEffectType();
-		if (EffectType) ProducerMap.Add(EffectType, Rule);
+		UE_LOG(LogSagaStats, Warning, TEXT("Pipeline %s Cook 时无法编译（循环依赖），不写入烘焙计划"), *GetName());
+		return;
 	}
 
-	// 3. 构建依赖图
-	TMap<UDamageRule*, TSet<UDamageRule*>> Dependencies;
-	TMap<UDamageRule*, TSet<UDamageRule*>> Dependents;
-	TMap<UDamageRule*, int32> InDegree;
+	CompiledPlan->ExportCooked(CookedPlan);
+	CookedPlan.ContentHash = ComputeCookedHash();
+}
 
-	for (UDamageRule* Rule : Rules)
+uint32 UDamagePipeline::ComputeCookedHash() const
+{
+	uint32 Hash = GetTypeHash(FDamageCookedPlan::CurrentVersion);
+	for (const TObjectPtr<UDamageRule>& Rule : DamageRules)
 	{
 		if (!Rule) continue;
-		Dependencies.FindOrAdd(Rule);
-		Dependents.FindOrAdd(Rule);
-		InDegree.FindOrAdd(Rule) = 0;
-	}
 
-	for (UDamageRule* Rule : Rules)
+		Hash = HashCombineFast(Hash, GetTypeHash(Rule->GetPathName()));
+		Hash = HashCombineFast(Hash, FCompiledDamagePipeline::HashOperationDeclaration(Rule->OperationClass, /*bStable=*/true));
+		Hash = HashCombineFast(Hash, FCompiledDamagePipeline::HashPredicateContent(Rule->Condition, /*bStable=*/true));
+	}
+	for (const TObjectPtr<UScriptStruct>& Type : ObservedEffects)
 	{
-		if (!Rule) continue;
-		TArray<UScriptStruct*> ConsumedTypes = Rule->GetConsumedEffectTypes();
-		for (UScriptStruct* Type : ConsumedTypes)
+		if (Type)
 		{
-			UDamageRule** ProducerPtr = ProducerMap.Find(Type);
-			if (ProducerPtr && *ProducerPtr != Rule)
-			{
-				UDamageRule* Producer = *ProducerPtr;
-				if (!Dependencies[Rule].Contains(Producer))
-				{
-					Dependencies[Rule].Add(Producer);
-					Dependents[Producer].Add(Rule);
-					InDegree[Rule]++;
-				}
-			}
+			Hash = HashCombineFast(Hash, GetTypeHash(Type->GetPathName()));
 		}
 	}
+	return Hash;
+}
 
-	// 4. 稳定 BFS
-	TArray<UDamageRule*> ReadyQueue;
-	for (UDamageRule* Rule : Rules)
+bool UDamagePipeline::RestoreCookedPlan(const FDamagePlanKey& Key)
+{
+	if (!CookedPlan.IsValid())
 	{
-		if (!Rule) continue;
-		if (InDegree[Rule] == 0)
+		return false;
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UDamagePipeline::RestoreCookedPlan);
+
+	FDamagePipelinePlanCache& Cache = FDamagePipelinePlanCache::Get();
+	TSharedPtr<FCompiledDamagePipeline> Plan = Cache.Find(Key);
+	if (!Plan)
+	{
+		if (CookedPlan.ContentHash != ComputeCookedHash())
+		{
+			UE_LOG(LogSagaStats, Log, TEXT("Pipeline %s 的烘焙计划与当前内容不一致，重新编译"), *GetName());
+			CookedPlan.Reset();
+			return false;
+		}
+
+		Plan = MakeShared<FCompiledDamagePipeline>();
+		if (!Plan->ImportCooked(CookedPlan))
 		{
-			ReadyQueue.Add(Rule);
+			UE_LOG(LogSagaStats, Warning, TEXT("Pipeline %s 的烘焙计划引用了已不存在的对象，重新编译"), *GetName());
+			CookedPlan.Reset();
+			return false;
 		}
+		Cache.Add(Key, Plan.ToSharedRef());
 	}
-	ReadyQueue.Sort([&OriginalIndex](const UDamageRule& A, const UDamageRule& B)
+
+	AdoptPlan(Plan.ToSharedRef());
+
+	// 计划已接管，序列化副本不再需要
+	CookedPlan.Reset();
+	return true;
+}
+
+// ============================================================================
+// 稳定拓扑排序（Kahn 算法 + 原始索引小顶堆，下标邻接数组）
+// ============================================================================
+
+FPipelineSortResult UDamagePipeline::StableTopologicalSort()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UDamagePipeline::StableTopologicalSort);
+
+	// 从 DamageRules 成员构建非 null 数组；下标即原始顺序（稳定排序的优先级）
+	TArray<UDamageRule*> Rules;
+	Rules.Reserve(DamageRules.Num());
+	for (const auto& Rule : DamageRules)
 	{
-		return OriginalIndex[const_cast<UDamageRule*>(&A)] < OriginalIndex[const_cast<UDamageRule*>(&B)];
-	});
+		if (Rule) Rules.Add(Rule.Get());
+	}
+
+	FPipelineSortResult Result;
+	const int32 NumRules = Rules.Num();
+	if (NumRules == 0) return Result;
 
-	TArray<UDamageRule*> Sorted;
-	while (ReadyQueue.Num() > 0)
+	// 1. 生产者映射：EffectType -> Rule 下标（类型即 key；同类型多个生产者时后者覆盖）
+	TMap<UScriptStruct*, int32> ProducerIndex;
+	ProducerIndex.Reserve(NumRules);
+	for (int32 i = 0; i < NumRules; i++)
 	{
-		UDamageRule* Current = ReadyQueue[0];
-		ReadyQueue.RemoveAt(0);
-		Sorted.Add(Current);
+		if (UScriptStruct* EffectType = Rules[i]->GetProducesEffectType())
+		{
+			ProducerIndex.Add(EffectType, i);
+		}
+	}
 
-		for (UDamageRule* Dependent : Dependents[Current])
+	// 2. 依赖图：每个消费者对同一生产者只记一条边（LastConsumer 标记去重）
+	FDamageRuleGraph Graph;
+	Graph.Reset(NumRules, NumRules * 2);
+	TArray<int32> LastConsumer;
+	LastConsumer.Init(INDEX_NONE, NumRules);
+	for (int32 i = 0; i < NumRules; i++)
+	{
+		Graph.BeginNode();
+		for (UScriptStruct* Type : Rules[i]->GetConsumedEffectTypes())
 		{
-			InDegree[Dependent]--;
-			if (InDegree[Dependent] == 0)
+			const int32* Producer = ProducerIndex.Find(Type);
+			if (Producer && *Producer != i && LastConsumer[*Producer] != i)
 			{
-				int32 InsertIdx = 0;
-				int32 DepIdx = OriginalIndex[Dependent];
-				while (InsertIdx < ReadyQueue.Num() && OriginalIndex[ReadyQueue[InsertIdx]] < DepIdx)
-				{
-					InsertIdx++;
-				}
-				ReadyQueue.Insert(Dependent, InsertIdx);
+				LastConsumer[*Producer] = i;
+				Graph.AddDependency(*Producer);
 			}
 		}
 	}
+	Graph.Finalize();
 
-	// 5. 环检测
-	if (Sorted.Num() < Rules.Num())
+	// 3. 稳定 Kahn（二叉堆按原始下标出队）
+	TArray<int32> Order;
+	if (!Graph.StableSort(Order))
 	{
+		// 4. 环检测：未排出的 Rule 及其未排出的上游
 		Result.bHasCycle = true;
-		for (UDamageRule* Rule : Rules)
+
+		TBitArray<> bSorted(false, NumRules);
+		for (int32 Index : Order)
+		{
+			bSorted[Index] = true;
+		}
+
+		for (int32 i = 0; i < NumRules; i++)
 		{
-			if (!Rule) continue;
-			if (!Sorted.Contains(Rule))
+			if (bSorted[i]) continue;
+
+			FString DepNames;
+			for (int32 Dep : Graph.GetDependencies(i))
 			{
-				FString DepNames;
-				for (UDamageRule* Dep : Dependencies[Rule])
+				if (!bSorted[Dep])
 				{
-					if (!Sorted.Contains(Dep))
-					{
-						if (!DepNames.IsEmpty()) DepNames += TEXT(", ");
-						DepNames += Dep->GetName();
-					}
+					if (!DepNames.IsEmpty()) DepNames += TEXT(", ");
+					DepNames += Rules[Dep]->GetName();
 				}
-				Result.CycleInfo.Add(FString::Printf(TEXT("%s depends on [%s]"),
-					*Rule->GetName(), *DepNames));
 			}
+			Result.CycleInfo.Add(FString::Printf(TEXT("%s depends on [%s]"),
+				*Rules[i]->GetName(), *DepNames));
 		}
 	}
 
-	for (UDamageRule* Rule : Sorted)
+	Result.SortedRules.Reserve(Order.Num());
+	for (int32 Index : Order)
 	{
-		Result.SortedRules.Add(Rule);
+		Result.SortedRules.Add(Rules[Index]);
 	}
 
 	return Result;
 }
 
+bool UDamagePipeline::IsStableInsertion(const FCompiledDamagePipeline& Plan, int32 InsertIndex)
+{
+	const int32 NumSlots = Plan.Layout->Num();
+
+	// 窗口内每个 Slot 的生产者数；前缀也产出的 Slot 由哪个生产者生效取决于 DamageRules 下标，保守视为不稳定
+	TArray<int32, TInlineAllocator<32>> WindowProducers;
+	WindowProducers.Init(0, NumSlots);
+	TBitArray<> PrefixProduced(false, NumSlots);
+	for (int32 RuleIndex = 0; RuleIndex < Plan.Rules.Num(); ++RuleIndex)
+	{
+		const int32 Slot = Plan.Rules[RuleIndex].EffectSlot;
+		if (Slot == INDEX_NONE) continue;
+
+		if (RuleIndex < InsertIndex)
+		{
+			PrefixProduced[Slot] = true;
+		}
+		else
+		{
+			++WindowProducers[Slot];
+		}
+	}
+
+	// 新 Rule 之后的每条 Rule 都必须依赖窗口内（另一条 Rule）的产出，否则完整 Build 会先于新 Rule 排出它
+	for (int32 RuleIndex = InsertIndex + 1; RuleIndex < Plan.Rules.Num(); ++RuleIndex)
+	{
+		const FCompiledDamageRule& Compiled = Plan.Rules[RuleIndex];
+		bool bBlocked = false;
+		for (const int32 Slot : Plan.GetReadSlots(Compiled))
+		{
+			const int32 OtherProducers = WindowProducers[Slot] - (Compiled.EffectSlot == Slot ? 1 : 0);
+			if (OtherProducers > 0)
+			{
+				if (PrefixProduced[Slot])
+				{
+					return false;
+				}
+				bBlocked = true;
+			}
+		}
+		if (!bBlocked)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 // ============================================================================
 // Build：拓扑排序烘焙
 // ============================================================================
@@ -208,14 +303,40 @@ FPipelineSortResult UDamagePipeline::Build()
 Build()
 ├── 阶段 1：输入净化 + EffectType 合法性校验
 ├── 阶段 2：稳定拓扑排序（StableTopologicalSort）
-│     ├── Step 1: 分配原始索引（稳定性的基础）
-│     ├── Step 2: 构建生产者映射（ProducerMap）
-│     ├── Step 3: 构建依赖图（Dependencies + Dependents + InDegree）
-│     ├── Step 4: Kahn BFS 稳定排序
-│     └── Step 5: 环检测
-└── 阶段 3：写回 SortedRules、设置 bIsBaked、输出日志
+│     ├── Step 1: 构建生产者映射（EffectType → Rule 下标；下标即稳定性的基础）
+│     ├── Step 2: 构建依赖图（FDamageRuleGraph，CSR 邻接数组）
+│     ├── Step 3: Kahn 稳定排序（原始下标小顶堆）
+│     └── Step 4: 环检测
+├── 阶段 3：死 Rule 消除（ObservedEffects 非空时）
+├── 阶段 4：写回 SortedRules、设置 bIsBaked
+└── 阶段 5：编译执行计划（CompilePlan）、输出日志
 	 */
 	
+	// ---- 计划缓存：相同 Rule 集合已编译过则直接共享（其校验与排序必然通过）；其次是 Cook 产出的计划 ----
+	const FDamagePlanKey PlanKey = FDamagePlanKey::Make(DamageRules, ObservedEffects);
+	TSharedPtr<FCompiledDamagePipeline> Cached = FDamagePipelinePlanCache::Get().Find(PlanKey);
+	if (Cached)
+	{
+		AdoptPlan(Cached.ToSharedRef());
+	}
+	if (Cached || RestoreCookedPlan(PlanKey))
+	{
+		bIsBaked = true;
+
+		FPipelineSortResult Result;
+		Result.SortedRules = SortedRules;
+		for (const auto& Rule : DamageRules)
+		{
+			if (Rule && !SortedRules.Contains(Rule))
+			{
+				Result.PrunedRules.Add(Rule);
+			}
+		}
+		UE_LOG(LogSagaStats, Log, TEXT("Pipeline Build 复用%s: %s（%d 条 Rule）"),
+			Cached ? TEXT("计划缓存") : TEXT("烘焙计划"), *GetName(), SortedRules.Num());
+		return Result;
+	}
+
 	TArray<UDamageRule*> RawPtrs;
 	for (const auto& Rule : DamageRules)
 	{
@@ -227,35 +348,8 @@ Build()
 
 	for (const auto& Rule : RawPtrs)
 	{
-		if (!Rule) continue;
-
-		// 校验 Operation 的 ProducesEffectType
-		if (!Rule->GetProducesEffectType())
-		{
-			UE_LOG(LogSagaStats, Error, TEXT("Pipeline Build 校验失败: DamageRule [%s] 的 Operation 未配置 ProducesEffectType"),
-				*Rule->GetName());
-			bValidationFailed = true;
-		}
-
-		// 校验 Condition 树中所有叶子的 EffectType
-		// - _Effect 子类：必须配置 EffectType（R5 产销依赖）
-		// - _Context 子类：不要求 EffectType（设计上就不贡献产销依赖）
-		if (Rule->Condition)
-		{
-			TArray<const UDamageCondition*> Leaves;
-			CollectLeafConditions(Rule->Condition, Leaves);
-			for (const UDamageCondition* Cond : Leaves)
-			{
-				const UDamageCondition_Effect* EffectCond = Cast<UDamageCondition_Effect>(Cond);
-				if (EffectCond && !EffectCond->GetEffectType())
-				{
-					UE_LOG(LogSagaStats, Error,
-						TEXT("Pipeline Build 校验失败: DamageRule [%s] 的 Condition_Effect [%s] 未配置 EffectType"),
-						*Rule->GetName(), *Cond->GetClass()->GetName());
-					bValidationFailed = true;
-				}
-			}
-		}
+		// 不短路：一次报出全部问题
+		bValidationFailed |= !ValidateRule(Rule);
 	}
 
 	FPipelineSortResult Result;
@@ -270,6 +364,12 @@ Build()
 	// ---- 拓扑排序 ----
 	Result = StableTopologicalSort();
 
+	// ---- 死 Rule 消除 ----
+	if (!Result.bHasCycle && ObservedEffects.Num() > 0)
+	{
+		PruneUnobservedRules(Result);
+	}
+
 	SortedRules.Empty();
 	for (const auto& Rule : Result.SortedRules)
 	{
@@ -278,6 +378,16 @@ Build()
 
 	bIsBaked = !Result.bHasCycle;
 
+	// ---- 编译执行计划 ----
+	if (bIsBaked)
+	{
+		CompilePlan(PlanKey);
+	}
+	else
+	{
+		AdoptPlan(MakeShared<FCompiledDamagePipeline>());
+	}
+
 	if (Result.bHasCycle)
 	{
 		UE_LOG(LogSagaStats, Error, TEXT("Pipeline Build 检测到循环依赖:"));
@@ -294,417 +404,1740 @@ Build()
 			if (!SortOrder.IsEmpty()) SortOrder += TEXT(" -> ");
 			SortOrder += Rule->GetName();
 		}
-		UE_LOG(LogSagaStats, Log, TEXT("Pipeline Build 完成: %s"), *SortOrder);
+		UE_LOG(LogSagaStats, Log, TEXT("Pipeline Build 完成: %s（%d 层，最宽 %d）"),
+			*SortOrder, CompiledPlan->NumLevels(), CompiledPlan->MaxLevelWidth);
 	}
 
 	return Result;
 }
 
-// ============================================================================
-// Execute：管线执行
-// ============================================================================
-
-TArray<FRuleExecutionEntry> UDamagePipeline::Execute(UDamageContext* Context)
+void UDamagePipeline::PruneUnobservedRules(FPipelineSortResult& Result) const
 {
-	TArray<FRuleExecutionEntry> ExecutionLog;
-
-	if (!bIsBaked)
-	{
-		Build();
-	}
-
-	if (!bIsBaked)
+	// 拓扑逆序遍历：消费者先于生产者出现，遇到被需要的 Rule 时把它消费的类型并入需要集合
+	TSet<const UScriptStruct*> Needed;
+	for (const UScriptStruct* Type : ObservedEffects)
 	{
-		UE_LOG(LogSagaStats, Error, TEXT("Pipeline 未烘焙（可能有循环依赖），无法执行"));
-		return ExecutionLog;
+		if (Type) Needed.Add(Type);
 	}
 
-	for (UDamageRule* Rule : SortedRules)
+	TSet<const UDamageRule*> Kept;
+	for (int32 i = Result.SortedRules.Num() - 1; i >= 0; --i)
 	{
-		if (!Rule) continue;
-
-		FRuleExecutionEntry Entry;
-		Entry.RuleName = Rule->GetFName();
-
-		// 评估 Predicate（调用 EvaluatePredicate 以应用 bReverse）
-		if (Rule->Condition)
+		const UDamageRule* Rule = Result.SortedRules[i];
+		if (Needed.Contains(Rule->GetProducesEffectType()))
 		{
-			if (!Rule->Condition->EvaluatePredicate(Context))
+			Kept.Add(Rule);
+			for (UScriptStruct* Type : Rule->GetConsumedEffectTypes())
 			{
-				Entry.bExecuted = false;
-				ExecutionLog.Add(Entry);
-				UE_LOG(LogSagaStats, Log, TEXT("  [SKIP] %s"), *Rule->GetName());
-				continue;
+				Needed.Add(Type);
 			}
 		}
+	}
 
-		// 执行逻辑：框架创建 OutEffect → Operation 填字段 → 写入 DC
-		if (Rule->OperationClass)
-		{
-			UDamageOperationBase* Op = GetOrCreateOperation(Rule->OperationClass);
-			UScriptStruct* EffectType = Rule->GetProducesEffectType();
-			if (Op && EffectType)
-			{
-				FInstancedStruct OutEffect(EffectType);
-				Op->Execute(Context, OutEffect);
+	if (Kept.Num() == Result.SortedRules.Num())
+	{
+		return;
+	}
 
-				// 校验 OutEffect 类型与声明的 ProducesEffectType 一致
-				if (OutEffect.IsValid() && OutEffect.GetScriptStruct() == EffectType)
-				{
-					Context->SetEffectByType(OutEffect);
-				}
-				else
-				{
-					UE_LOG(LogSagaStats, Error,
-						TEXT("DamageRule %s: OutEffect 类型不匹配！期望 %s，实际 %s"),
-						*Rule->GetName(),
-						*EffectType->GetName(),
-						OutEffect.IsValid() ? *OutEffect.GetScriptStruct()->GetName() : TEXT("invalid"));
-				}
-			}
+	// 被裁剪的按声明顺序报告；保留的维持拓扑序
+	for (const auto& Rule : DamageRules)
+	{
+		if (Rule && !Kept.Contains(Rule))
+		{
+			Result.PrunedRules.Add(Rule);
 		}
-
-		Entry.bExecuted = true;
-		ExecutionLog.Add(Entry);
-		UE_LOG(LogSagaStats, Log, TEXT("  [EXEC] %s"), *Rule->GetName());
 	}
+	Result.SortedRules.RemoveAll([&Kept](const TObjectPtr<UDamageRule>& Rule)
+	{
+		return !Kept.Contains(Rule);
+	});
 
-	UE_LOG(LogSagaStats, Log, TEXT("%s"), *Context->DumpToString());
-
-	if (bAutoExportMermaid)
+	FString PrunedNames;
+	for (const auto& Rule : Result.PrunedRules)
 	{
-		ExportMermaidDAG(ExecutionLog, Context);
+		if (!PrunedNames.IsEmpty()) PrunedNames += TEXT(", ");
+		PrunedNames += Rule->GetName();
 	}
-
-	return ExecutionLog;
+	UE_LOG(LogSagaStats, Log, TEXT("Pipeline %s: 裁剪 %d 条不影响 ObservedEffects 的 Rule: %s"),
+		*GetName(), Result.PrunedRules.Num(), *PrunedNames);
 }
 
-UDamageOperationBase* UDamagePipeline::GetOrCreateOperation(TSubclassOf<UDamageOperationBase> OperationClass)
+bool UDamagePipeline::ValidateRule(const UDamageRule* Rule) const
 {
-	if (!OperationClass) return nullptr;
+	bool bValid = true;
 
-	UClass* ClassPtr = OperationClass.Get();
-	if (TObjectPtr<UDamageOperationBase>* Found = OperationInstances.Find(ClassPtr))
+	// 校验 Operation 的 ProducesEffectType
+	if (!Rule->GetProducesEffectType())
 	{
-		return Found->Get();
+		UE_LOG(LogSagaStats, Error, TEXT("Pipeline Build 校验失败: DamageRule [%s] 的 Operation 未配置 ProducesEffectType"),
+			*Rule->GetName());
+		bValid = false;
 	}
 
-	UDamageOperationBase* NewOp = NewObject<UDamageOperationBase>(this, ClassPtr);
-	OperationInstances.Add(ClassPtr, NewOp);
-	return NewOp;
+	// 校验 Condition 树中所有叶子的 EffectType
+	// - _Effect 子类：必须配置 EffectType（R5 产销依赖）
+	// - _Context 子类：不要求 EffectType（设计上就不贡献产销依赖）
+	if (Rule->Condition)
+	{
+		TArray<const UDamageCondition*> Leaves;
+		CollectLeafConditions(Rule->Condition, Leaves);
+		for (const UDamageCondition* Cond : Leaves)
+		{
+			const UDamageCondition_Effect* EffectCond = Cast<UDamageCondition_Effect>(Cond);
+			if (EffectCond && !EffectCond->GetEffectType())
+			{
+				UE_LOG(LogSagaStats, Error,
+					TEXT("Pipeline Build 校验失败: DamageRule [%s] 的 Condition_Effect [%s] 未配置 EffectType"),
+					*Rule->GetName(), *Cond->GetClass()->GetName());
+				bValid = false;
+			}
+		}
+	}
+
+	return bValid;
 }
 
 // ============================================================================
-// Mermaid DAG 导出
+// 增量修改：运行时加入 / 移除 Rule
 // ============================================================================
 
-static const TCHAR* FieldColorPalette[] = {
-	TEXT("#e6194b"), TEXT("#3cb44b"), TEXT("#4363d8"), TEXT("#f58231"),
-	TEXT("#911eb4"), TEXT("#42d4f4"), TEXT("#f032e6"), TEXT("#bfef45"),
-	TEXT("#fabed4"), TEXT("#469990"), TEXT("#dcbeff"), TEXT("#9a6324"),
-	TEXT("#fffac8"), TEXT("#800000"), TEXT("#aaffc3"), TEXT("#808000"),
-	TEXT("#ffd8b1"), TEXT("#000075"), TEXT("#a9a9a9"), TEXT("#e6beff"),
-};
-static const int32 FieldColorPaletteSize = UE_ARRAY_COUNT(FieldColorPalette);
-
-void UDamagePipeline::ExportMermaidDAG(
-	const TArray<FRuleExecutionEntry>& ExecutionLog,
-	const UDamageContext* Context) const
+bool UDamagePipeline::AddRule(UDamageRule* Rule)
 {
-	// 执行状态映射
-	TMap<FName, bool> ExecStatusMap;
-	for (const FRuleExecutionEntry& Entry : ExecutionLog)
+	if (!Rule || DamageRules.Contains(Rule) || !ValidateRule(Rule))
 	{
-		ExecStatusMap.Add(Entry.RuleName, Entry.bExecuted);
+		return false;
 	}
 
-	// DamageRule 间依赖的颜色分配（以 DamageRule Name 为单位着色）
-	TMap<FName, FString> RuleColorMap;
-	{
-		TArray<FName> OrderedRules;
-		for (const auto& Rule : SortedRules)
-		{
-			if (!Rule) continue;
-			if (!RuleColorMap.Contains(Rule->GetFName()))
-			{
-				RuleColorMap.Add(Rule->GetFName(), FieldColorPalette[OrderedRules.Num() % FieldColorPaletteSize]);
-				OrderedRules.Add(Rule->GetFName());
-			}
-		}
-	}
+	DamageRules.Add(Rule);
 
-	// EffectType→DamageRule 映射用于依赖连线
-	TMap<UScriptStruct*, const UDamageRule*> EffectTypeToProducer;
-	for (const auto& Rule : SortedRules)
+	// 尚未编译：留给下一次 Build（SortedRules 已过期，不能再走懒编译）
+	if (!bIsBaked || !CompiledPlan->bCompiled)
 	{
-		if (!Rule) continue;
-		UScriptStruct* FT = Rule->GetProducesEffectType();
-		if (FT) EffectTypeToProducer.Add(FT, Rule);
+		bIsBaked = false;
+		return true;
 	}
 
-	// ---- 构造多行 label 的 helper ----
-	// 在节点内多行 label 下，每行 pad 到相同 visual 字符数——配合 monospace 字体，
-	// Mermaid 默认居中对齐会让所有行 bounding box 等宽，文字视觉上从同一 X 左对齐。
-	// ASCII 树字符（├─ └─ │）的缩进层级因此能正确显示。
-	//
-	// Lines: TArray<TPair<Text, VisualLen>>
-	//   Text 可含 HTML 标签（<font> / <b>），VisualLen 是渲染字符数（不含标签）
-	auto BuildPaddedLabel = [](const TArray<TPair<FString, int32>>& Lines) -> FString
-	{
-		int32 MaxVL = 0;
-		for (const auto& L : Lines) MaxVL = FMath::Max(MaxVL, L.Value);
-
-		FString Out;
-		for (int32 i = 0; i < Lines.Num(); ++i)
-		{
-			if (i > 0) Out += TEXT("<br/>");
-			Out += Lines[i].Key;
-			const int32 Pad = MaxVL - Lines[i].Value;
-			for (int32 p = 0; p < Pad; ++p)
-			{
-				// U+00A0 NO-BREAK SPACE —— monospace 下占 1 字宽；
-				// 避免 Mermaid 把空格合并 / 把 &nbsp; 错误转义
-				Out += TEXT("\u00A0");
-			}
-		}
-		return Out;
-	};
-
-	// ---- 生成 Mermaid ----
-	FString M;
-
-	// 注入 monospace 字体（节点内 ASCII 树缩进需要等宽字符）
-	M += TEXT("%%{init: {'themeVariables': {'fontFamily': 'monospace'}}}%%\n");
-	M += TEXT("graph LR\n");
+	TRACE_CPUPROFILER_EVENT_SCOPE(UDamagePipeline::AddRule);
 
-	FString Label = ScenarioLabel.IsEmpty() ? TEXT("Damage Pipeline") : ScenarioLabel;
-	M += FString::Printf(TEXT("    %%%% %s - %s\n\n"), *Label, *FDateTime::Now().ToString());
-
-	M += TEXT("    classDef exec fill:#d4edda,stroke:#28a745,color:#000\n");
-	M += TEXT("    classDef skip fill:#e2e3e5,stroke:#6c757d,color:#666\n");
-	M += TEXT("    classDef initCtx fill:#fff3cd,stroke:#ffc107,color:#000\n");
-	M += TEXT("    classDef finalCtx fill:#cce5ff,stroke:#004085,color:#000\n\n");
-
-	// DC Init 节点（显示非 DamageRule 产出的 Effect = 攻击上下文）
-	bool bHasInitialEffects = false;
-	if (Context)
+	// 其他玩家已组装过同一组合：直接共享
+	const FDamagePlanKey PlanKey = FDamagePlanKey::Make(DamageRules, ObservedEffects);
+	if (TSharedPtr<FCompiledDamagePipeline> Cached = FDamagePipelinePlanCache::Get().Find(PlanKey))
 	{
-		TArray<TPair<FString, int32>> InitLines;
-		const FString HeaderText = TEXT("<b>DC Initial</b>");
-		const int32 HeaderVL = 10; // "DC Initial"
-		InitLines.Add({HeaderText, HeaderVL});
-
-		for (const auto& Pair : Context->GetAllDamageEffects())
-		{
-			if (!EffectTypeToProducer.Contains(Pair.Key))
-			{
-				FString TypeName = Pair.Key ? Pair.Key->GetName() : TEXT("null");
-				FString Line = FString::Printf(TEXT("[%s]"), *TypeName);
-				InitLines.Add({Line, Line.Len()});
-				bHasInitialEffects = true;
-			}
-		}
-		if (bHasInitialEffects)
-		{
-			M += FString::Printf(TEXT("    DC_Init[\"%s\"]:::initCtx\n\n"), *BuildPaddedLabel(InitLines));
-		}
+		AdoptPlan(Cached.ToSharedRef());
+		return true;
 	}
 
-	// DamageRule 节点
-	for (int32 i = 0; i < SortedRules.Num(); i++)
+	// 裁剪取决于整个依赖图（新 Rule 可能让此前被裁剪的上游重新可达）：完整重建
+	if (ObservedEffects.Num() > 0)
 	{
-		const UDamageRule* Rule = SortedRules[i];
-		if (!Rule) continue;
-
-		const bool* bExec = ExecStatusMap.Find(Rule->GetFName());
-		bool bExecuted = bExec ? *bExec : false;
-		FString StyleClass = bExecuted ? TEXT("exec") : TEXT("skip");
+		Build();
+		return bIsBaked;
+	}
 
-		// 收集所有行到 (Text, VisualLen) 列表，最后 BuildPaddedLabel 统一 pad
-		TArray<TPair<FString, int32>> Lines;
+	// 新 Rule 在已排序计划中的约束：排在全部上游（产出其消费类型的 Rule）之后、
+	// 全部下游（消费其产出类型的 Rule）之前
+	UScriptStruct* ProducedType = Rule->GetProducesEffectType();
+	const TArray<UScriptStruct*> ConsumedTypes = Rule->GetConsumedEffectTypes();
+	const int32 ProducedSlot = CompiledPlan->FindEffectSlot(ProducedType);
 
-		// 标题行（格式与 Graph Editor 节点一致：1-based 序号 + RuleName）
+	int32 LastProducer = INDEX_NONE;
+	int32 FirstConsumer = INDEX_NONE;
+	bool bReplacesProducer = false;
+	for (int32 RuleIndex = 0; RuleIndex < CompiledPlan->Rules.Num(); ++RuleIndex)
+	{
+		const FCompiledDamageRule& Compiled = CompiledPlan->Rules[RuleIndex];
+		if (ProducedSlot != INDEX_NONE && Compiled.EffectSlot == ProducedSlot)
 		{
-			FString Title = FString::Printf(TEXT("%d. %s"), i + 1, *Rule->GetName());
-			Lines.Add({Title, Title.Len()});
+			bReplacesProducer = true;
+			break;
 		}
-
-		// Condition 行（可能多行 —— ASCII 树按 \n 拆）
-		if (Rule->Condition)
+		if (Compiled.EffectType && ConsumedTypes.Contains(Compiled.EffectType))
 		{
-			FString Raw = Rule->Condition->GetDisplayString();
-			Raw.ReplaceInline(TEXT("\""), TEXT("#quot;"));
-
-			TArray<FString> CondLines;
-			Raw.ParseIntoArray(CondLines, TEXT("\n"), /*CullEmpty=*/false);
-
-			for (int32 j = 0; j < CondLines.Num(); ++j)
-			{
-				// 首行加 "Cond: " 前缀，后续行加等宽空格让 ASCII 树缩进对齐
-				FString LineText = (j == 0 ? TEXT("Cond: ") : TEXT("      ")) + CondLines[j];
-				Lines.Add({LineText, LineText.Len()});
-			}
+			LastProducer = RuleIndex;
 		}
-		else
+		if (FirstConsumer == INDEX_NONE && ProducedSlot != INDEX_NONE && CompiledPlan->GetReadSlots(Compiled).Contains(ProducedSlot))
 		{
-			FString LineText = TEXT("Cond: (none)");
-			Lines.Add({LineText, LineText.Len()});
+			FirstConsumer = RuleIndex;
 		}
+	}
 
-		// Produces: 行
-		{
-			FString T = TEXT("Produces:");
-			Lines.Add({T, T.Len()});
-		}
+	// 顶替已有生产者会改写其下游的依赖边；上下游约束冲突需要重排（也可能成环）——都退回完整 Build
+	if (bReplacesProducer || (FirstConsumer != INDEX_NONE && LastProducer >= FirstConsumer))
+	{
+		UE_LOG(LogSagaStats, Verbose, TEXT("Pipeline %s: AddRule [%s] 无法就地插入，完整重建"),
+			*GetName(), *Rule->GetName());
+		Build();
+		return bIsBaked;
+	}
 
-		// Effect 行
-		{
-			FString ProdName = Rule->GetProducesEffectType()
-				? Rule->GetProducesEffectType()->GetName() : TEXT("(none)");
-			FString TypeColor = RuleColorMap.FindRef(Rule->GetFName());
-			if (!TypeColor.IsEmpty() && Rule->GetProducesEffectType())
-			{
-				// <font> 标签不计入 VisualLen；■ 占 1 字宽 + 空格 1 字宽
-				FString T = FString::Printf(TEXT("<font color='%s'>#9632;</font> %s"),
-					*TypeColor, *ProdName);
-				int32 VL = 1 /*■*/ + 1 /*space*/ + ProdName.Len();
-				Lines.Add({T, VL});
-			}
-			else
-			{
-				Lines.Add({ProdName, ProdName.Len()});
-			}
-		}
+	// 无下游时追加到末尾——与完整 Build 的稳定序一致；有下游时插在第一个下游之前。
+	// 新类型不与已有 Rule 构成 WAW，因此任何满足依赖的位置执行结果都相同
+	const int32 InsertIndex = FirstConsumer != INDEX_NONE ? FirstConsumer : CompiledPlan->Rules.Num();
 
-		M += FString::Printf(TEXT("    %s[\"%s\"]:::%s\n"),
-			*Rule->GetName(), *BuildPaddedLabel(Lines), *StyleClass);
-	}
+	TArray<UScriptStruct*> NewTypes = ConsumedTypes;
+	NewTypes.Add(ProducedType);
 
-	M += TEXT("\n");
+	FCompiledDamagePipeline& Plan = GetMutablePlan();
+	Plan.ExtendLayout(NewTypes);
 
-	// 连线
-	int32 LinkIndex = 0;
-	struct FColoredLink { int32 Index; FString Color; };
-	TArray<FColoredLink> ColoredLinks;
+	FCompiledDamageRule Compiled;
+	Plan.CompileRule(Rule, Compiled);
+	Plan.Rules.Insert(Compiled, InsertIndex);
+	Plan.Finish();
 
-	// 隐藏执行顺序链
-	if (bHasInitialEffects && SortedRules.Num() > 0)
+	// 满足依赖的插入位置未必是完整 Build 的稳定序：顺序不同的计划不占用同一个键，只供本 Pipeline 使用
+	const bool bStableOrder = bPlanInStableOrder && IsStableInsertion(Plan, InsertIndex);
+	if (bStableOrder)
 	{
-		M += FString::Printf(TEXT("    DC_Init ~~~ %s\n"), *SortedRules[0]->GetName());
-		LinkIndex++;
+		FDamagePipelinePlanCache::Get().Add(PlanKey, CompiledPlan);
 	}
-	for (int32 i = 0; i + 1 < SortedRules.Num(); i++)
+	else
 	{
-		M += FString::Printf(TEXT("    %s ~~~ %s\n"),
-			*SortedRules[i]->GetName(), *SortedRules[i + 1]->GetName());
-		LinkIndex++;
+		UE_LOG(LogSagaStats, Verbose, TEXT("Pipeline %s: AddRule [%s] 后的顺序未必与完整 Build 相同，不放入计划缓存"),
+			*GetName(), *Rule->GetName());
 	}
-	if (SortedRules.Num() > 0)
+	AdoptPlan(CompiledPlan, bStableOrder);
+	return true;
+}
+
+bool UDamagePipeline::RemoveRule(UDamageRule* Rule)
+{
+	if (!Rule || DamageRules.Remove(Rule) == 0)
 	{
-		M += FString::Printf(TEXT("    %s ~~~ DC_Final\n"), *SortedRules.Last()->GetName());
-		LinkIndex++;
+		return false;
 	}
-	M += TEXT("\n");
 
-	// 产销依赖连线（EffectType 匹配）
-	for (const auto& Rule : SortedRules)
+	const int32 RuleIndex = bIsBaked && CompiledPlan->bCompiled ? FindCompiledRuleIndex(Rule) : INDEX_NONE;
+	if (RuleIndex == INDEX_NONE)
 	{
-		if (!Rule) continue;
-		TArray<UScriptStruct*> ConsumedTypes = Rule->GetConsumedEffectTypes();
+		bIsBaked = false;
+		return true;
+	}
 
-		for (UScriptStruct* Type : ConsumedTypes)
-		{
-			const UDamageRule** ProducerDef = EffectTypeToProducer.Find(Type);
-			FString TypeName = Type ? Type->GetName() : TEXT("?");
+	TRACE_CPUPROFILER_EVENT_SCOPE(UDamagePipeline::RemoveRule);
 
-			if (ProducerDef && *ProducerDef)
-			{
-				FString ProducerName = (*ProducerDef)->GetName();
-				FString FieldColor = RuleColorMap.FindRef((*ProducerDef)->GetFName());
+	const FDamagePlanKey PlanKey = FDamagePlanKey::Make(DamageRules, ObservedEffects);
+	if (TSharedPtr<FCompiledDamagePipeline> Cached = FDamagePipelinePlanCache::Get().Find(PlanKey))
+	{
+		AdoptPlan(Cached.ToSharedRef());
+		return true;
+	}
 
-				M += FString::Printf(TEXT("    %s -->|%s| %s\n"),
-					*ProducerName, *TypeName, *Rule->GetName());
+	// 裁剪开启时移除 Rule 可能让更多上游变得不可达：完整重建
+	if (ObservedEffects.Num() > 0)
+	{
+		Build();
+		return bIsBaked;
+	}
 
-				if (!FieldColor.IsEmpty())
-				{
-					ColoredLinks.Add({LinkIndex, FieldColor});
-				}
-			}
-			else if (bHasInitialEffects)
-			{
-				M += FString::Printf(TEXT("    DC_Init -->|%s| %s\n"),
-					*TypeName, *Rule->GetName());
-			}
-			else { continue; }
+	// 删除节点只会去掉依赖边，剩余顺序仍然合法；
+	// 唯一例外是被它顶替的同类型生产者重新生效（下游改连），退回完整 Build
+	// 被删 Rule 没有下游时，其余 Rule 的稳定序不变；有下游时它们可能在完整 Build 中提前
+	const int32 RemovedSlot = CompiledPlan->Rules[RuleIndex].EffectSlot;
+	bool bHasConsumer = false;
+	for (int32 Other = 0; Other < CompiledPlan->Rules.Num() && RemovedSlot != INDEX_NONE; ++Other)
+	{
+		if (Other == RuleIndex) continue;
 
-			LinkIndex++;
+		const FCompiledDamageRule& OtherRule = CompiledPlan->Rules[Other];
+		if (OtherRule.EffectSlot == RemovedSlot)
+		{
+			UE_LOG(LogSagaStats, Verbose, TEXT("Pipeline %s: RemoveRule [%s] 涉及同类型生产者，完整重建"),
+				*GetName(), *Rule->GetName());
+			Build();
+			return bIsBaked;
 		}
+		bHasConsumer = bHasConsumer || CompiledPlan->GetReadSlots(OtherRule).Contains(RemovedSlot);
 	}
 
-	M += TEXT("\n");
+	FCompiledDamagePipeline& Plan = GetMutablePlan();
+	Plan.RemoveRuleAt(RuleIndex);
+	Plan.Finish();
 
-	// linkStyle 着色
-	for (const FColoredLink& Link : ColoredLinks)
+	// 删除后剩余的顺序未必是完整 Build 的稳定序：顺序不同的计划不占用同一个键，只供本 Pipeline 使用
+	const bool bStableOrder = bPlanInStableOrder && !bHasConsumer;
+	if (bStableOrder)
 	{
-		M += FString::Printf(TEXT("    linkStyle %d stroke:%s,stroke-width:2px\n"),
-			Link.Index, *Link.Color);
+		FDamagePipelinePlanCache::Get().Add(PlanKey, CompiledPlan);
 	}
-
-	M += TEXT("\n");
-
-	// DC Final 节点（所有 DamageRule 产出的 Effect + 攻击上下文）
-	if (Context)
+	else
+	{
+		UE_LOG(LogSagaStats, Verbose, TEXT("Pipeline %s: RemoveRule [%s] 后的顺序未必与完整 Build 相同，不放入计划缓存"),
+			*GetName(), *Rule->GetName());
+	}
+	AdoptPlan(CompiledPlan, bStableOrder);
+	return true;
+}
+
+// ============================================================================
+// CompilePlan：生成扁平执行计划
+// ============================================================================
+
+void UDamagePipeline::CompilePlan(const FDamagePlanKey& Key)
+{
+	FDamagePipelinePlanCache& Cache = FDamagePipelinePlanCache::Get();
+	if (TSharedPtr<FCompiledDamagePipeline> Cached = Cache.Find(Key))
+	{
+		AdoptPlan(Cached.ToSharedRef());
+		return;
+	}
+
+	// 共享计划不可变：总是编译到新对象
+	TSharedRef<FCompiledDamagePipeline> Plan = MakeShared<FCompiledDamagePipeline>();
+
+	// 先提取跨 Rule 的公共子谓词，各 Rule 编译时引用
+	TArray<const UDamagePredicate*> Roots;
+	Roots.Reserve(SortedRules.Num());
+	for (UDamageRule* Rule : SortedRules)
+	{
+		if (Rule) Roots.Add(Rule->Condition);
+	}
+	Plan->ShareCommonPredicates(Roots);
+
+	Plan->Rules.Reserve(SortedRules.Num());
+	for (UDamageRule* Rule : SortedRules)
+	{
+		if (!Rule) continue;
+		Plan->CompileRule(Rule, Plan->Rules.AddDefaulted_GetRef());
+	}
+	Plan->Finish();
+
+	Cache.Add(Key, Plan);
+	AdoptPlan(Plan);
+}
+
+void UDamagePipeline::AdoptPlan(const TSharedRef<FCompiledDamagePipeline>& Plan, bool bStableOrder)
+{
+	CompiledPlan = Plan;
+	bPlanInStableOrder = bStableOrder;
+
+	// 缓存命中时排序结果来自计划
+	SortedRules.Reset(Plan->Rules.Num());
+	for (const FCompiledDamageRule& Compiled : Plan->Rules)
+	{
+		SortedRules.Add(Compiled.Rule);
+	}
+
+#if SAGASTATS_DAMAGE_TRACE
+	// 追踪记录只存 Rule 下标，导出时经此名表解析
+	TArray<FName> TraceRuleNames;
+	for (const FCompiledDamageRule& Compiled : Plan->Rules)
+	{
+		TraceRuleNames.Add(Compiled.Rule->GetFName());
+	}
+	FDamagePipelineTrace::RegisterPipeline(GetUniqueID(), GetName(), MoveTemp(TraceRuleNames));
+#endif
+
+	ClassifyStages();
+
+	// 子计划按 Rule 下标记录，随计划作废
+	{
+		FScopeLock Lock(&SubPlanLock);
+		SubPlans.Reset();
+		NextSubPlan.Reset();
+		SubPlanByHash.Reset();
+	}
+
+	// Rule 下标已变：旧的 Worker 实例组作废
+	WorkerOperationTable.Reset();
+	WorkerOperationInstances.Reset();
+}
+
+void UDamagePipeline::ClassifyStages()
+{
+	const FCompiledDamagePipeline& Plan = *CompiledPlan;
+	const int32 NumSlots = Plan.Layout->Num();
+
+	// 外部输入 = 没有 Rule 产出的 Slot；其中不在 SourceEffects 里的是目标侧
+	TBitArray<> TargetSlots(true, NumSlots);
+	for (const FCompiledDamageRule& Compiled : Plan.Rules)
+	{
+		if (Compiled.Operation && Compiled.EffectSlot != INDEX_NONE)
+		{
+			TargetSlots[Compiled.EffectSlot] = false;
+		}
+	}
+	for (const TObjectPtr<UScriptStruct>& Type : SourceEffects)
 	{
-		TArray<TPair<FString, int32>> FinalLines;
-		FinalLines.Add({TEXT("<b>DC Final</b>"), 8 /* "DC Final" */});
+		const int32 Slot = Type ? Plan.FindEffectSlot(Type) : INDEX_NONE;
+		if (Slot != INDEX_NONE)
+		{
+			TargetSlots[Slot] = false;
+		}
+	}
 
-		for (const auto& Pair : Context->GetAllDamageEffects())
+	// 拓扑序传递：读取目标侧 Slot 的 Rule 属于目标阶段，其产出也成为目标侧。
+	// 同类型允许多个生产者：目标侧 Slot 的全部写入者都归入目标阶段（否则源阶段先写、目标分叉的覆盖
+	// 会遮住源阶段在拓扑序上更晚的写入）。被拉入的写入者可能位于更早处，因此迭代到不再变化。
+	TargetStageRules.Init(false, Plan.Rules.Num());
+	bool bChanged = true;
+	while (bChanged)
+	{
+		bChanged = false;
+		for (int32 RuleIndex = 0; RuleIndex < Plan.Rules.Num(); ++RuleIndex)
 		{
-			FString TypeName = Pair.Key ? Pair.Key->GetName() : TEXT("null");
-			// 查找产出此 Effect 的 DamageRule（攻击上下文无 producer）
-			FString Line;
-			if (const UDamageRule** Producer = EffectTypeToProducer.Find(Pair.Key))
+			const FCompiledDamageRule& Compiled = Plan.Rules[RuleIndex];
+			const bool bProduces = Compiled.Operation && Compiled.EffectSlot != INDEX_NONE;
+			const bool bTargetStage = TargetStageRules[RuleIndex]
+				|| (bProduces && TargetSlots[Compiled.EffectSlot])
+				|| Plan.GetReadSlots(Compiled).ContainsByPredicate([&TargetSlots](int32 Slot) { return TargetSlots[Slot]; });
+			if (!bTargetStage)
 			{
-				Line = FString::Printf(TEXT("%s: %s"), *(*Producer)->GetName(), *TypeName);
+				continue;
 			}
-			else
+
+			if (!TargetStageRules[RuleIndex])
 			{
-				Line = FString::Printf(TEXT("[ctx] %s"), *TypeName);
+				TargetStageRules[RuleIndex] = true;
+				bChanged = true;
+			}
+			if (bProduces && !TargetSlots[Compiled.EffectSlot])
+			{
+				TargetSlots[Compiled.EffectSlot] = true;
+				bChanged = true;
 			}
-			FinalLines.Add({Line, Line.Len()});
 		}
+	}
+
+	// 源阶段只读写源侧 Slot：与目标阶段之间没有 RAW / WAR / WAW
+	SourceStageSlots.Init(false, NumSlots);
+	for (int32 RuleIndex = 0; RuleIndex < Plan.Rules.Num(); ++RuleIndex)
+	{
+		if (TargetStageRules[RuleIndex]) continue;
 
-		if (FinalLines.Num() > 1)
+		const FCompiledDamageRule& Compiled = Plan.Rules[RuleIndex];
+		for (int32 Slot : Plan.GetReadSlots(Compiled))
 		{
-			M += FString::Printf(TEXT("    DC_Final[\"%s\"]:::finalCtx\n"), *BuildPaddedLabel(FinalLines));
+			SourceStageSlots[Slot] = true;
 		}
-		else
+		if (Compiled.Operation && Compiled.EffectSlot != INDEX_NONE)
 		{
-			FinalLines.Add({TEXT("(empty)"), 7});
-			M += FString::Printf(TEXT("    DC_Final[\"%s\"]:::finalCtx\n"), *BuildPaddedLabel(FinalLines));
+			SourceStageSlots[Compiled.EffectSlot] = true;
+		}
+	}
+
+	UE_LOG(LogSagaStats, Verbose, TEXT("Pipeline %s 阶段划分: 源阶段 %d 条，目标阶段 %d 条"),
+		*GetName(), Plan.Rules.Num() - TargetStageRules.CountSetBits(), TargetStageRules.CountSetBits());
+}
+
+FCompiledDamagePipeline& UDamagePipeline::GetMutablePlan()
+{
+	// 与缓存或其他 Pipeline 共享时先复制（Layout / Operation 实例仍共享，二者在计划内不被修改）
+	if (!CompiledPlan.IsUnique())
+	{
+		CompiledPlan = MakeShared<FCompiledDamagePipeline>(*CompiledPlan);
+	}
+	return *CompiledPlan;
+}
+
+void UDamagePipeline::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
+{
+	Super::AddReferencedObjects(InThis, Collector);
+
+	// 私有计划（增量修改产生、或已被缓存淘汰）只由本 Pipeline 持有
+	CastChecked<UDamagePipeline>(InThis)->CompiledPlan->AddReferencedObjects(Collector);
+}
+
+// ============================================================================
+// Execute：管线执行
+// ============================================================================
+
+bool UDamagePipeline::PrepareExecution()
+{
+	if (!bIsBaked)
+	{
+		Build();
+	}
+
+	if (!bIsBaked)
+	{
+		UE_LOG(LogSagaStats, Error, TEXT("Pipeline 未烘焙（可能有循环依赖），无法执行"));
+		return false;
+	}
+
+	// SortedRules 来自序列化（资产加载）时 CompiledPlan 尚未生成：优先恢复 Cook 产出的计划
+	if (!CompiledPlan->bCompiled)
+	{
+		const FDamagePlanKey Key = FDamagePlanKey::Make(DamageRules, ObservedEffects);
+		if (!RestoreCookedPlan(Key))
+		{
+			CompilePlan(Key);
+		}
+	}
+
+	return true;
+}
+
+int32 UDamagePipeline::GetMaxBatchWorkers()
+{
+	return FMath::Max(1, FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+}
+
+bool UDamagePipeline::Warmup(const TArray<UDamageContext*>& Contexts, int32 NumParallelWorkers)
+{
+	TArray<FDamageContext*, TInlineAllocator<32>> NativeContexts;
+	for (UDamageContext* Context : Contexts)
+	{
+		NativeContexts.Add(Context ? &Context->GetNativeContext() : nullptr);
+	}
+	return Warmup(NativeContexts, NumParallelWorkers);
+}
+
+bool UDamagePipeline::Warmup(TConstArrayView<FDamageContext*> Contexts, int32 NumParallelWorkers)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UDamagePipeline::Warmup);
+
+	if (!PrepareExecution())
+	{
+		return false;
+	}
+
+	for (FDamageContext* Context : Contexts)
+	{
+		if (Context)
+		{
+			Context->BindLayout(CompiledPlan->Layout);
+			Context->ConstructAllSlots();
 		}
 	}
 
-	M += TEXT("\n");
+	if (NumParallelWorkers != 0 && CompiledPlan->bThreadSafe)
+	{
+		const int32 MaxWorkers = GetMaxBatchWorkers();
+		EnsureWorkerOperations(NumParallelWorkers < 0 ? MaxWorkers : FMath::Min(NumParallelWorkers, MaxWorkers));
+	}
+
+	UE_LOG(LogSagaStats, Log, TEXT("Pipeline %s 预热完成: %d 条 Rule，%d 个 Operation，%d 个 Context"),
+		*GetName(), CompiledPlan->Rules.Num(), CompiledPlan->Operations.Num(), Contexts.Num());
+	return true;
+}
+
+bool UDamagePipeline::ExecuteNative(UDamageContext* Context, FDamageExecutionResult& OutResult, TArrayView<bool> OutExecuted)
+{
+	return ExecuteNative(Context ? &Context->GetNativeContext() : nullptr, OutResult, OutExecuted);
+}
 
-	// 保存文件
-	FString SafeLabel = Label.Replace(TEXT(" "), TEXT("_")).Replace(TEXT("."), TEXT("_"));
-	FString FileName = FString::Printf(TEXT("DR_DAG_%s_%s.mmd"),
-		*SafeLabel, *FDateTime::Now().ToString(TEXT("%Y%m%d_%H%M%S")));
-	FString FilePath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Graphs"), FileName);
+bool UDamagePipeline::ExecuteNative(FDamageContext* Context, FDamageExecutionResult& OutResult, TArrayView<bool> OutExecuted)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UDamagePipeline::Execute);
 
-	FString DirPath = FPaths::GetPath(FilePath);
-	if (!FPlatformFileManager::Get().GetPlatformFile().DirectoryExists(*DirPath))
+	if (!Context || !PrepareExecution())
 	{
-		FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*DirPath);
+		OutResult.Reset(0);
+		return false;
 	}
 
-	if (FFileHelper::SaveStringToFile(M, *FilePath, FFileHelper::EEncodingOptions::ForceUTF8))
+	Context->BindLayout(CompiledPlan->Layout);
+
+	const int32 NumRules = CompiledPlan->Rules.Num();
+	OutResult.Reset(NumRules);
+	check(OutExecuted.Num() == 0 || OutExecuted.Num() >= NumRules);
+
+	// 最宽一层不足以摊薄分发开销时不并发
+	constexpr int32 MinParallelLevelWidth = 4;
+	const bool bUseLevels = bParallelLevels && CompiledPlan->bThreadSafe
+		&& CompiledPlan->MaxLevelWidth >= MinParallelLevelWidth && IsInGameThread();
+
+	if (bUseLevels)
 	{
-		UE_LOG(LogSagaStats, Log, TEXT("Mermaid DAG 已保存: %s"), *FilePath);
+		// 并发阶段按字节写 bool（位图按 word 打包，并发置位不安全），结束后再压成位图
+		TArray<bool> Executed;
+		TArray<bool> Produced;
+		ExecuteLevels(Context, Executed, Produced);
+		for (int32 RuleIndex = 0; RuleIndex < NumRules; ++RuleIndex)
+		{
+			OutResult.Executed[RuleIndex] = Executed[RuleIndex];
+			OutResult.Produced[RuleIndex] = Produced[RuleIndex];
+			SG_DAMAGE_TRACE_RULE_UNTIMED(GetUniqueID(), Context->GetContextId(), RuleIndex, Executed[RuleIndex]);
+		}
 	}
 	else
 	{
-		UE_LOG(LogSagaStats, Error, TEXT("Mermaid DAG 保存失败: %s"), *FilePath);
+		FDamagePredicateMemo Memo;
+		Memo.Reset(CompiledPlan->NumMemoEntries());
+		for (int32 RuleIndex = 0; RuleIndex < NumRules; ++RuleIndex)
+		{
+			SG_DAMAGE_TRACE_BEGIN(TraceStart);
+			bool bProduced = false;
+			const bool bExecuted = ExecuteCompiledRule(CompiledPlan->Rules[RuleIndex], Context, &Memo, &bProduced);
+			SG_DAMAGE_TRACE_RULE(GetUniqueID(), Context->GetContextId(), RuleIndex, bExecuted, TraceStart);
+			OutResult.Executed[RuleIndex] = bExecuted;
+			OutResult.Produced[RuleIndex] = bProduced;
+		}
+	}
+
+	if (OutExecuted.Num() > 0)
+	{
+		for (int32 RuleIndex = 0; RuleIndex < NumRules; ++RuleIndex)
+		{
+			OutExecuted[RuleIndex] = OutResult.Executed[RuleIndex];
+		}
+	}
+
+	// 参数只在 VeryVerbose 开启时求值
+	UE_LOG(LogSagaStats, VeryVerbose, TEXT("%s"), *Context->DumpToString());
+
+	if (bAutoExportMermaid)
+	{
+		ExportMermaidDAG(OutResult, Context);
+	}
+
+	return true;
+}
+
+TArray<FRuleExecutionEntry> UDamagePipeline::Execute(UDamageContext* Context)
+{
+	FDamageExecutionResult Result;
+	ExecuteNative(Context, Result);
+	return MakeExecutionLog(Result);
+}
+
+// ============================================================================
+// 执行结果解析
+// ============================================================================
+
+UDamageRule* UDamagePipeline::GetCompiledRule(int32 RuleIndex) const
+{
+	return CompiledPlan->Rules.IsValidIndex(RuleIndex) ? CompiledPlan->Rules[RuleIndex].Rule : nullptr;
+}
+
+int32 UDamagePipeline::FindCompiledRuleIndex(const UDamageRule* Rule) const
+{
+	return CompiledPlan->Rules.IndexOfByPredicate([Rule](const FCompiledDamageRule& Compiled)
+	{
+		return Compiled.Rule == Rule;
+	});
+}
+
+TArray<FRuleExecutionEntry> UDamagePipeline::MakeExecutionLog(const FDamageExecutionResult& Result) const
+{
+	TArray<FRuleExecutionEntry> ExecutionLog;
+	const int32 Num = FMath::Min(Result.Num(), CompiledPlan->Rules.Num());
+	ExecutionLog.Reserve(Num);
+	for (int32 RuleIndex = 0; RuleIndex < Num; ++RuleIndex)
+	{
+		FRuleExecutionEntry& Entry = ExecutionLog.AddDefaulted_GetRef();
+		Entry.RuleName = CompiledPlan->Rules[RuleIndex].Rule->GetFName();
+		Entry.bExecuted = Result.Executed[RuleIndex];
+	}
+	return ExecutionLog;
+}
+
+// ============================================================================
+// ExecuteFor：按需执行
+// ============================================================================
+
+bool UDamagePipeline::ExecuteForNative(UDamageContext* Context, TConstArrayView<UScriptStruct*> RequestedEffects, FDamageExecutionResult& OutResult)
+{
+	return ExecuteForNative(Context ? &Context->GetNativeContext() : nullptr, RequestedEffects, OutResult);
+}
+
+bool UDamagePipeline::ExecuteForNative(FDamageContext* Context, TConstArrayView<UScriptStruct*> RequestedEffects, FDamageExecutionResult& OutResult)
+{
+	if (!Context || !PrepareExecution())
+	{
+		OutResult.Reset(0);
+		return false;
+	}
+
+	Context->BindLayout(CompiledPlan->Layout);
+	OutResult.Reset(CompiledPlan->Rules.Num());
+
+	// 请求类型 → Slot（升序去重作为缓存键）；不在布局中的类型没有任何 Rule 产出，忽略
+	TArray<int32, TInlineAllocator<8>> RequestedSlots;
+	for (const UScriptStruct* Type : RequestedEffects)
+	{
+		const int32 Slot = Type ? CompiledPlan->FindEffectSlot(Type) : INDEX_NONE;
+		if (Slot != INDEX_NONE)
+		{
+			RequestedSlots.AddUnique(Slot);
+		}
+	}
+	RequestedSlots.Sort();
+
+	const FDamageSubPlan& SubPlan = FindOrBuildSubPlan(RequestedSlots);
+
+	// 子计划只删去 Rule、不改变相对次序，全量计划的记忆安全性依然成立
+	FDamagePredicateMemo Memo;
+	Memo.Reset(CompiledPlan->NumMemoEntries());
+	for (int32 RuleIndex : SubPlan.RuleIndices)
+	{
+		SG_DAMAGE_TRACE_BEGIN(TraceStart);
+		bool bProduced = false;
+		const bool bExecuted = ExecuteCompiledRule(CompiledPlan->Rules[RuleIndex], Context, &Memo, &bProduced);
+		SG_DAMAGE_TRACE_RULE(GetUniqueID(), Context->GetContextId(), RuleIndex, bExecuted, TraceStart);
+		OutResult.Executed[RuleIndex] = bExecuted;
+		OutResult.Produced[RuleIndex] = bProduced;
+	}
+
+	return true;
+}
+
+const FDamageSubPlan& UDamagePipeline::FindOrBuildSubPlan(TConstArrayView<int32> RequestedSlots)
+{
+	uint32 Hash = 0;
+	for (int32 Slot : RequestedSlots)
+	{
+		Hash = HashCombineFast(Hash, GetTypeHash(Slot));
+	}
+
+	FScopeLock Lock(&SubPlanLock);
+
+	const int32* First = SubPlanByHash.Find(Hash);
+	const int32 FirstIndex = First ? *First : INDEX_NONE;
+	for (int32 Index = FirstIndex; Index != INDEX_NONE; Index = NextSubPlan[Index])
+	{
+		const TArray<int32>& Cached = SubPlans[Index]->RequestedSlots;
+		if (Cached.Num() == RequestedSlots.Num()
+			&& FMemory::Memcmp(Cached.GetData(), RequestedSlots.GetData(), Cached.Num() * sizeof(int32)) == 0)
+		{
+			return *SubPlans[Index];
+		}
+	}
+
+	FDamageSubPlan& SubPlan = *SubPlans.Add_GetRef(MakeUnique<FDamageSubPlan>());
+	CompiledPlan->BuildSubPlan(RequestedSlots, SubPlan);
+
+	NextSubPlan.Add(FirstIndex);
+	SubPlanByHash.Add(Hash, SubPlans.Num() - 1);
+	return SubPlan;
+}
+
+TArray<FRuleExecutionEntry> UDamagePipeline::ExecuteFor(UDamageContext* Context, const TArray<UScriptStruct*>& RequestedEffects)
+{
+	FDamageExecutionResult Result;
+	ExecuteForNative(Context, RequestedEffects, Result);
+	return MakeExecutionLog(Result);
+}
+
+// ============================================================================
+// ExecuteSpeculative：分叉 Context 上的增量推演
+// ============================================================================
+//
+// 按拓扑序单趟扫描，DirtySlots 记录值可能与父 Context 不同的 Slot：
+//   - 初值为分叉中已写入 / 遮蔽的 Slot（分歧输入）
+//   - Rule 读取任一脏 Slot → 重跑；父 Context 中该 Slot 确有 Rule 产出时，重跑前遮蔽这份旧产出
+//     （分歧输入、父 Context 自身的预填值都不遮蔽，与预填输入语义一致），产出 Slot 变脏
+//   - 否则执行结果取自 ParentResult；若其产出 Slot 被分叉预写过而父 Context 中该 Rule 写入了产出，
+//     完整执行时预写值会被同样的产出覆盖——撤销预写、改为透读父 Context，Slot 恢复干净。
+//     父 Context 中谓词通过但 Operation 放弃了产出时，完整执行会保留预写值，不撤销
+// 只看 ParentResult.Produced、不看 Executed：谓词通过不代表 Slot 被写过。
+// 跳过的 Rule 只减少写入、不改变写入次序，谓词记忆的安全性与全量执行相同。
+
+bool UDamagePipeline::ExecuteSpeculative(UDamageContext* Fork, const FDamageExecutionResult& ParentResult, FDamageExecutionResult& OutResult)
+{
+	return ExecuteSpeculative(Fork ? &Fork->GetNativeContext() : nullptr, ParentResult, OutResult);
+}
+
+bool UDamagePipeline::ExecuteSpeculative(FDamageContext* Fork, const FDamageExecutionResult& ParentResult, FDamageExecutionResult& OutResult)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UDamagePipeline::ExecuteSpeculative);
+
+	if (!Fork || !PrepareExecution())
+	{
+		OutResult.Reset(0);
+		return false;
+	}
+
+	const int32 NumRules = CompiledPlan->Rules.Num();
+	const FDamageContext* Parent = Fork->GetParent();
+
+	// 父 Context 绑定的不是本计划的布局：Slot 序号对不上，先脱离（把可见 Effect 拷入分叉自身）
+	if (Parent && Parent->Layout != CompiledPlan->Layout)
+	{
+		Fork->Detach();
+		Parent = nullptr;
+	}
+
+	const bool bReuseParent = Parent && Fork->Layout == CompiledPlan->Layout
+		&& ParentResult.Num() == NumRules && ParentResult.Produced.Num() == NumRules;
+
+	// 无法复用时绑定布局（分叉随之脱离父 Context），全部 Rule 重跑
+	Fork->BindLayout(CompiledPlan->Layout);
+	OutResult.Reset(NumRules);
+
+	// 仍是分叉（未脱离）时，重跑 Rule 前要遮蔽父 Context 的旧产出
+	const bool bForked = Fork->GetParent() != nullptr;
+
+	const int32 NumSlots = CompiledPlan->Layout->Num();
+
+	// 多写入者 Slot：父 Context 里只剩最后一个写入者的值，中间值无从复用。
+	// 这类 Slot 从一开始视为脏，其全部写入者都重跑
+	TBitArray<> WrittenSlots(false, NumSlots);
+	TBitArray<> MultiWriterSlots(false, NumSlots);
+	// 父 Context 中确由 Rule 写入的 Slot（未复用父结果时无从得知，全部视为是）
+	TBitArray<> ParentProducedSlots(!bReuseParent, NumSlots);
+	for (int32 RuleIndex = 0; RuleIndex < NumRules; ++RuleIndex)
+	{
+		const FCompiledDamageRule& Compiled = CompiledPlan->Rules[RuleIndex];
+		if (Compiled.Operation && Compiled.EffectSlot != INDEX_NONE)
+		{
+			MultiWriterSlots[Compiled.EffectSlot] = MultiWriterSlots[Compiled.EffectSlot] || WrittenSlots[Compiled.EffectSlot];
+			WrittenSlots[Compiled.EffectSlot] = true;
+			if (bReuseParent && ParentResult.Produced[RuleIndex])
+			{
+				ParentProducedSlots[Compiled.EffectSlot] = true;
+			}
+		}
+	}
+
+	TBitArray<> DirtySlots(!bReuseParent, NumSlots);
+	TBitArray<> InputSlots(false, NumSlots);
+	TBitArray<> MaskedSlots(false, NumSlots);
+	DirtySlots.CombineWithBitwiseOR(MultiWriterSlots, EBitwiseOperatorFlags::MaintainSize);
+	if (bForked)
+	{
+		for (int32 Slot = 0; Slot < NumSlots; ++Slot)
+		{
+			if (Fork->IsSlotOverridden(Slot))
+			{
+				DirtySlots[Slot] = true;
+				InputSlots[Slot] = true;
+			}
+		}
+	}
+
+	FDamagePredicateMemo Memo;
+	Memo.Reset(CompiledPlan->NumMemoEntries());
+	int32 NumRerun = 0;
+	for (int32 RuleIndex = 0; RuleIndex < NumRules; ++RuleIndex)
+	{
+		const FCompiledDamageRule& Compiled = CompiledPlan->Rules[RuleIndex];
+		const int32 Slot = Compiled.EffectSlot;
+
+		const bool bProduces = Slot != INDEX_NONE && Compiled.Operation;
+		bool bDirty = !bReuseParent || (bProduces && MultiWriterSlots[Slot]);
+		for (int32 ReadSlot : CompiledPlan->GetReadSlots(Compiled))
+		{
+			bDirty = bDirty || DirtySlots[ReadSlot];
+		}
+
+		if (!bDirty)
+		{
+			const bool bParentProduced = ParentResult.Produced[RuleIndex];
+			OutResult.Executed[RuleIndex] = ParentResult.Executed[RuleIndex];
+			OutResult.Produced[RuleIndex] = bParentProduced;
+			if (bParentProduced && bProduces && InputSlots[Slot])
+			{
+				Fork->RevertSlot(Slot);
+				DirtySlots[Slot] = false;
+			}
+			continue;
+		}
+
+		if (bProduces)
+		{
+			// 只在该 Slot 第一个重跑的写入者前遮蔽一次：后续写入者应看到前一个写入者的产出。
+			// 父 Context 没有 Rule 写过该 Slot 时，其中的值是父 Context 的预填输入，完整执行同样可见
+			if (bForked && !InputSlots[Slot] && !MaskedSlots[Slot] && ParentProducedSlots[Slot])
+			{
+				Fork->RemoveEffectBySlot(Slot);
+				MaskedSlots[Slot] = true;
+			}
+			DirtySlots[Slot] = true;
+		}
+
+		SG_DAMAGE_TRACE_BEGIN(TraceStart);
+		bool bProduced = false;
+		const bool bExecuted = ExecuteCompiledRule(Compiled, Fork, &Memo, &bProduced);
+		SG_DAMAGE_TRACE_RULE(GetUniqueID(), Fork->GetContextId(), RuleIndex, bExecuted, TraceStart);
+		OutResult.Executed[RuleIndex] = bExecuted;
+		OutResult.Produced[RuleIndex] = bProduced;
+		++NumRerun;
+	}
+
+	UE_LOG(LogSagaStats, VeryVerbose, TEXT("Pipeline %s 推演: 重跑 %d / %d 条 Rule%s"),
+		*GetName(), NumRerun, NumRules, bReuseParent ? TEXT("") : TEXT("（未复用父 Context）"));
+	return true;
+}
+
+// ============================================================================
+// ExecuteMultiTarget：源阶段一次 + 目标阶段逐目标
+// ============================================================================
+//
+// 源阶段 Rule 只读源侧 Slot（不读任何目标阶段的产出），目标阶段 Rule 只写目标侧 Slot：
+// 两组之间没有 RAW / WAR / WAW，先整体执行源阶段、再执行目标阶段与按拓扑序交错执行等价。
+// 目标 Context 是源 Context 的分叉：源阶段产出直接透读，只有目标阶段的产出占用目标自己的 Arena。
+
+bool UDamagePipeline::ExecuteMultiTarget(TConstArrayView<FInstancedStruct> SourceInputs,
+	TConstArrayView<TArray<FInstancedStruct>> TargetInputs,
+	FDamageContext& OutSource, TArray<FDamageContext>& OutTargets,
+	TArray<FDamageExecutionResult>* OutResults)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UDamagePipeline::ExecuteMultiTarget);
+
+	if (OutResults)
+	{
+		OutResults->Reset();
+	}
+
+	if (!PrepareExecution())
+	{
+		return false;
+	}
+
+	const int32 NumRules = CompiledPlan->Rules.Num();
+	const int32 NumMemoEntries = CompiledPlan->NumMemoEntries();
+
+	// ---- 源阶段 ----
+	OutSource.Reset();
+	OutSource.BindLayout(CompiledPlan->Layout);
+	for (const FInstancedStruct& Input : SourceInputs)
+	{
+		OutSource.SetEffectByType(Input);
+	}
+
+	FDamageExecutionResult SourceResult;
+	SourceResult.Reset(NumRules);
+	FDamagePredicateMemo Memo;
+	Memo.Reset(NumMemoEntries);
+	for (int32 RuleIndex = 0; RuleIndex < NumRules; ++RuleIndex)
+	{
+		if (!TargetStageRules[RuleIndex])
+		{
+			SG_DAMAGE_TRACE_BEGIN(TraceStart);
+			bool bProduced = false;
+			const bool bExecuted = ExecuteCompiledRule(CompiledPlan->Rules[RuleIndex], &OutSource, &Memo, &bProduced);
+			SG_DAMAGE_TRACE_RULE(GetUniqueID(), OutSource.GetContextId(), RuleIndex, bExecuted, TraceStart);
+			SourceResult.Executed[RuleIndex] = bExecuted;
+			SourceResult.Produced[RuleIndex] = bProduced;
+		}
+	}
+
+	// ---- 目标阶段 ----
+	OutTargets.SetNum(TargetInputs.Num());
+	if (OutResults)
+	{
+		OutResults->SetNum(TargetInputs.Num());
+	}
+
+	for (int32 TargetIndex = 0; TargetIndex < TargetInputs.Num(); ++TargetIndex)
+	{
+		// 上一次的分叉仍指向 OutSource 且布局未变：丢弃其写入后复用（Arena 与已构造的 Slot 保留）
+		FDamageContext& Target = OutTargets[TargetIndex];
+		if (Target.GetParent() == &OutSource && Target.Layout == OutSource.Layout)
+		{
+			Target.Reset();
+		}
+		else
+		{
+			Target = OutSource.Fork();
+		}
+
+		bool bSharesSource = true;
+		for (const FInstancedStruct& Input : TargetInputs[TargetIndex])
+		{
+			const int32 Slot = Input.GetScriptStruct() ? CompiledPlan->FindEffectSlot(Input.GetScriptStruct()) : INDEX_NONE;
+			bSharesSource = bSharesSource && (Slot == INDEX_NONE || !SourceStageSlots[Slot]);
+			Target.SetEffectByType(Input);
+		}
+
+		FDamageExecutionResult LocalResult;
+		FDamageExecutionResult& Result = OutResults ? (*OutResults)[TargetIndex] : LocalResult;
+
+		if (!bSharesSource)
+		{
+			UE_LOG(LogSagaStats, Warning, TEXT("Pipeline %s: 目标 %d 的输入覆盖了源阶段读写的 Effect，该目标按完整执行处理"),
+				*GetName(), TargetIndex);
+			ExecuteSpeculative(&Target, FDamageExecutionResult(), Result);
+			continue;
+		}
+
+		Result = SourceResult;
+		Memo.Reset(NumMemoEntries);
+		for (int32 RuleIndex = 0; RuleIndex < NumRules; ++RuleIndex)
+		{
+			if (TargetStageRules[RuleIndex])
+			{
+				SG_DAMAGE_TRACE_BEGIN(TraceStart);
+				bool bProduced = false;
+				const bool bExecuted = ExecuteCompiledRule(CompiledPlan->Rules[RuleIndex], &Target, &Memo, &bProduced);
+				SG_DAMAGE_TRACE_RULE(GetUniqueID(), Target.GetContextId(), RuleIndex, bExecuted, TraceStart);
+				Result.Executed[RuleIndex] = bExecuted;
+				Result.Produced[RuleIndex] = bProduced;
+			}
+		}
+	}
+
+	return true;
+}
+
+// ============================================================================
+// ExecuteLevels：单 Context 按拓扑层并发执行
+// ============================================================================
+//
+// Context 的存在位图（TBitArray）按 word 打包，并发置位不安全——所以每层分三段：
+//   1. 并发评估谓词：只读 Context（本层没有任何写入）；同一 Context 并发求值，不使用谓词记忆
+//   2. 串行 EmplaceEffectBySlot：置存在位、重置 Slot
+//   3. 并发执行 Operation：各写各的 Slot（同层无 WAW），读取的 Slot 不被同层写入（同层无 RAW）
+// 同层 Operation 的 Slot 互不相同，因而也不会共享同一 Operation 实例（实例按类共享，类决定 Slot）。
+
+void UDamagePipeline::ExecuteLevels(FDamageContext* Context, TArray<bool>& OutExecuted, TArray<bool>& OutProduced)
+{
+	OutExecuted.Init(false, CompiledPlan->Rules.Num());
+	OutProduced.Init(false, CompiledPlan->Rules.Num());
+
+	TArray<FStructView> OutEffects;
+	TArray<FDamageSlotSnapshot> Snapshots;
+	TArray<bool> Produced;
+	for (int32 Level = 0; Level < CompiledPlan->NumLevels(); ++Level)
+	{
+		const int32 Begin = CompiledPlan->LevelStarts[Level];
+		const int32 Num = CompiledPlan->LevelStarts[Level + 1] - Begin;
+		const TConstArrayView<int32> LevelRules = MakeArrayView(CompiledPlan->LevelRules).Slice(Begin, Num);
+		const EParallelForFlags Flags = Num > 1 ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+
+		ParallelFor(Num, [&](int32 i)
+		{
+			const int32 RuleIndex = LevelRules[i];
+			OutExecuted[RuleIndex] = CompiledPlan->EvaluatePredicate(CompiledPlan->Rules[RuleIndex], Context);
+		}, Flags);
+
+		OutEffects.Reset();
+		OutEffects.SetNum(Num);
+		Snapshots.Reset();
+		Snapshots.SetNum(Num);
+		for (int32 i = 0; i < Num; ++i)
+		{
+			const FCompiledDamageRule& Compiled = CompiledPlan->Rules[LevelRules[i]];
+			if (OutExecuted[LevelRules[i]] && Compiled.Operation && Compiled.EffectSlot != INDEX_NONE)
+			{
+				OutEffects[i] = Context->EmplaceEffectBySlot(Compiled.EffectSlot, &Snapshots[i]);
+			}
+		}
+
+		Produced.Init(true, Num);
+		ParallelFor(Num, [&](int32 i)
+		{
+			if (OutEffects[i].IsValid())
+			{
+				Produced[i] = CompiledPlan->Rules[LevelRules[i]].Operation->ExecuteInPlace(Context, OutEffects[i]);
+			}
+		}, Flags);
+
+		for (int32 i = 0; i < Num; ++i)
+		{
+			if (!Produced[i])
+			{
+				Context->RestoreSlot(CompiledPlan->Rules[LevelRules[i]].EffectSlot, Snapshots[i]);
+			}
+			OutProduced[LevelRules[i]] = OutEffects[i].IsValid() && Produced[i];
+		}
+	}
+}
+
+// ============================================================================
+// ExecuteBatch：多 Context 批量执行（Rule 主序）
+// ============================================================================
+
+namespace
+{
+	/** UDamageContext 批量入口 → FDamageContext（保留 null 占位，日志下标与输入一致） */
+	TArray<FDamageContext*, TInlineAllocator<32>> GetNativeContexts(TArrayView<UDamageContext* const> Contexts)
+	{
+		TArray<FDamageContext*, TInlineAllocator<32>> NativeContexts;
+		NativeContexts.Reserve(Contexts.Num());
+		for (UDamageContext* Context : Contexts)
+		{
+			NativeContexts.Add(Context ? &Context->GetNativeContext() : nullptr);
+		}
+		return NativeContexts;
+	}
+}
+
+void UDamagePipeline::ExecuteBatch(TArrayView<UDamageContext* const> Contexts,
+	TArray<TArray<FRuleExecutionEntry>>* OutExecutionLogs)
+{
+	ExecuteBatch(GetNativeContexts(Contexts), OutExecutionLogs);
+}
+
+void UDamagePipeline::ExecuteBatchParallel(TArrayView<UDamageContext* const> Contexts,
+	TArray<TArray<FRuleExecutionEntry>>* OutExecutionLogs)
+{
+	ExecuteBatchParallel(GetNativeContexts(Contexts), OutExecutionLogs);
+}
+
+void UDamagePipeline::ExecuteBatch(TArrayView<FDamageContext* const> Contexts,
+	TArray<TArray<FRuleExecutionEntry>>* OutExecutionLogs)
+{
+	if (OutExecutionLogs)
+	{
+		OutExecutionLogs->Reset();
+		OutExecutionLogs->SetNum(Contexts.Num());
+	}
+
+	if (!PrepareExecution())
+	{
+		return;
+	}
+
+	// 过滤 null Context，记住原下标以便回填日志
+	TArray<FDamageContext*, TInlineAllocator<32>> Batch;
+	TArray<int32, TInlineAllocator<32>> BatchToInput;
+	for (int32 i = 0; i < Contexts.Num(); ++i)
+	{
+		if (FDamageContext* Context = Contexts[i])
+		{
+			Context->BindLayout(CompiledPlan->Layout);
+			Batch.Add(Context);
+			BatchToInput.Add(i);
+		}
+	}
+
+	EnsureWorkerOperations(1);
+	ExecuteBatchRange(Batch, GetWorkerOperations(0), BatchToInput, OutExecutionLogs);
+}
+
+void UDamagePipeline::ExecuteBatchParallel(TArrayView<FDamageContext* const> Contexts,
+	TArray<TArray<FRuleExecutionEntry>>* OutExecutionLogs)
+{
+	check(IsInGameThread());
+
+	if (!PrepareExecution())
+	{
+		if (OutExecutionLogs)
+		{
+			OutExecutionLogs->Reset();
+			OutExecutionLogs->SetNum(Contexts.Num());
+		}
+		return;
+	}
+
+	// 每个分块至少这么多 Context，避免调度开销超过执行本身
+	constexpr int32 MinContextsPerWorker = 4;
+	const int32 NumWorkers = FMath::Clamp(Contexts.Num() / MinContextsPerWorker, 1, GetMaxBatchWorkers());
+
+	if (!CompiledPlan->bThreadSafe || NumWorkers == 1)
+	{
+		ExecuteBatch(Contexts, OutExecutionLogs);
+		return;
+	}
+
+	if (OutExecutionLogs)
+	{
+		OutExecutionLogs->Reset();
+		OutExecutionLogs->SetNum(Contexts.Num());
+	}
+
+	// 游戏线程上完成所有 UObject 创建与 Arena 绑定，工作线程只读写各自的 Context
+	TArray<FDamageContext*> Batch;
+	TArray<int32> BatchToInput;
+	Batch.Reserve(Contexts.Num());
+	BatchToInput.Reserve(Contexts.Num());
+	for (int32 i = 0; i < Contexts.Num(); ++i)
+	{
+		if (FDamageContext* Context = Contexts[i])
+		{
+			Context->BindLayout(CompiledPlan->Layout);
+			Batch.Add(Context);
+			BatchToInput.Add(i);
+		}
+	}
+
+	EnsureWorkerOperations(NumWorkers);
+
+	// 连续分块：分块边界只取决于 Batch.Num() 与 NumWorkers，与调度无关
+	const int32 ChunkSize = FMath::DivideAndRoundUp(Batch.Num(), NumWorkers);
+	ParallelFor(NumWorkers, [&](int32 Worker)
+	{
+		const int32 Begin = Worker * ChunkSize;
+		const int32 Num = FMath::Min(ChunkSize, Batch.Num() - Begin);
+		if (Num <= 0) return;
+
+		ExecuteBatchRange(
+			TArrayView<FDamageContext* const>(Batch).Slice(Begin, Num),
+			GetWorkerOperations(Worker),
+			TArrayView<const int32>(BatchToInput).Slice(Begin, Num),
+			OutExecutionLogs);
+	});
+}
+
+void UDamagePipeline::ExecuteBatchRange(TArrayView<FDamageContext* const> Batch,
+	TArrayView<UDamageOperationBase* const> Operations,
+	TArrayView<const int32> InputIndices,
+	TArray<TArray<FRuleExecutionEntry>>* OutExecutionLogs)
+{
+	if (OutExecutionLogs)
+	{
+		for (int32 InputIndex : InputIndices)
+		{
+			(*OutExecutionLogs)[InputIndex].Reserve(CompiledPlan->Rules.Num());
+		}
+	}
+
+	// 每条 Rule 的命中子集（复用缓冲，Rule 之间不重新分配）
+	TArray<FDamageContext*, TInlineAllocator<32>> Active;
+	TArray<FStructView, TInlineAllocator<32>> OutEffects;
+	TArray<FDamageSlotSnapshot, TInlineAllocator<32>> Snapshots;
+
+	// Rule-major 遍历：每个 Context 各持一份谓词记忆，贯穿全部 Rule
+	TArray<FDamagePredicateMemo> Memos;
+	Memos.SetNum(Batch.Num());
+	for (FDamagePredicateMemo& Memo : Memos)
+	{
+		Memo.Reset(CompiledPlan->NumMemoEntries());
+	}
+
+	for (int32 RuleIndex = 0; RuleIndex < CompiledPlan->Rules.Num(); ++RuleIndex)
+	{
+		const FCompiledDamageRule& Compiled = CompiledPlan->Rules[RuleIndex];
+
+		Active.Reset();
+		for (int32 b = 0; b < Batch.Num(); ++b)
+		{
+			const bool bExecuted = CompiledPlan->EvaluatePredicate(Compiled, Batch[b], &Memos[b]);
+			if (bExecuted)
+			{
+				Active.Add(Batch[b]);
+			}
+
+			if (OutExecutionLogs)
+			{
+				FRuleExecutionEntry& Entry = (*OutExecutionLogs)[InputIndices[b]].AddDefaulted_GetRef();
+				Entry.RuleName = Compiled.Rule->GetFName();
+				Entry.bExecuted = bExecuted;
+			}
+		}
+
+		UDamageOperationBase* Operation = Operations[RuleIndex];
+		if (Active.Num() == 0 || !Operation || Compiled.EffectSlot == INDEX_NONE)
+		{
+			continue;
+		}
+
+		OutEffects.Reset();
+		Snapshots.Reset();
+		Snapshots.SetNum(Active.Num());
+		for (int32 a = 0; a < Active.Num(); ++a)
+		{
+			OutEffects.Add(Active[a]->EmplaceEffectBySlot(Compiled.EffectSlot, &Snapshots[a]));
+		}
+
+		Operation->ExecuteBatch(Active, OutEffects);
+
+		// Operation 把视图置为无效 = 放弃该 Context 的产出
+		for (int32 a = 0; a < Active.Num(); ++a)
+		{
+			if (!OutEffects[a].IsValid())
+			{
+				Active[a]->RestoreSlot(Compiled.EffectSlot, Snapshots[a]);
+			}
+		}
+	}
+}
+
+void UDamagePipeline::EnsureWorkerOperations(int32 NumWorkers)
+{
+	const int32 NumRules = CompiledPlan->Rules.Num();
+	const int32 NumExisting = NumRules > 0 ? WorkerOperationTable.Num() / NumRules : 0;
+	if (NumRules == 0 || NumExisting >= NumWorkers)
+	{
+		return;
+	}
+
+	WorkerOperationTable.Reserve(NumWorkers * NumRules);
+	for (int32 Worker = NumExisting; Worker < NumWorkers; ++Worker)
+	{
+		// 同一 Worker 内按类共享实例（与计划中 Operations 的语义一致）
+		TMap<UClass*, UDamageOperationBase*> WorkerInstances;
+		for (const FCompiledDamageRule& Compiled : CompiledPlan->Rules)
+		{
+			UDamageOperationBase* Operation = Compiled.Operation;
+			if (Operation && Worker > 0)
+			{
+				UDamageOperationBase*& Instance = WorkerInstances.FindOrAdd(Operation->GetClass());
+				if (!Instance)
+				{
+					Instance = NewObject<UDamageOperationBase>(this, Operation->GetClass());
+					Instance->ResolveNativeDispatch();
+					WorkerOperationInstances.Add(Instance);
+				}
+				Operation = Instance;
+			}
+			WorkerOperationTable.Add(Operation);
+		}
+	}
+}
+
+TArrayView<UDamageOperationBase* const> UDamagePipeline::GetWorkerOperations(int32 Worker) const
+{
+	const int32 NumRules = CompiledPlan->Rules.Num();
+	return TArrayView<UDamageOperationBase* const>(WorkerOperationTable).Slice(Worker * NumRules, NumRules);
+}
+
+bool UDamagePipeline::ExecuteCompiledRule(const FCompiledDamageRule& Compiled, FDamageContext* Context,
+	FDamagePredicateMemo* Memo, bool* OutProduced)
+{
+	if (OutProduced)
+	{
+		*OutProduced = false;
+	}
+
+	// 评估谓词字节码（bReverse 已在编译期折叠进跳转）
+	if (!CompiledPlan->EvaluatePredicate(Compiled, Context, Memo))
+	{
+		return false;
+	}
+
+	// 执行逻辑：框架在 DC 中就地分配 Slot → Operation 原地填字段
+	if (Compiled.Operation && Compiled.EffectSlot != INDEX_NONE)
+	{
+		// 放弃产出时恢复 Slot 原有的值（外部输入 / 同类型先前生产者的产出），而不是清空
+		FDamageSlotSnapshot Snapshot;
+		FStructView OutEffect = Context->EmplaceEffectBySlot(Compiled.EffectSlot, &Snapshot);
+		const bool bProduced = Compiled.Operation->ExecuteInPlace(Context, OutEffect);
+		if (!bProduced)
+		{
+			Context->RestoreSlot(Compiled.EffectSlot, Snapshot);
+		}
+		if (OutProduced)
+		{
+			*OutProduced = bProduced;
+		}
+	}
+
+	return true;
+}
+
+// ============================================================================
+// Mermaid DAG 导出
+// ============================================================================
+
+static const TCHAR* FieldColorPalette[] = {
+	TEXT("#e6194b"), TEXT("#3cb44b"), TEXT("#4363d8"), TEXT("#f58231"),
+	TEXT("#911eb4"), TEXT("#42d4f4"), TEXT("#f032e6"), TEXT("#bfef45"),
+	TEXT("#fabed4"), TEXT("#469990"), TEXT("#dcbeff"), TEXT("#9a6324"),
+	TEXT("#fffac8"), TEXT("#800000"), TEXT("#aaffc3"), TEXT("#808000"),
+	TEXT("#ffd8b1"), TEXT("#000075"), TEXT("#a9a9a9"), TEXT("#e6beff"),
+};
+static const int32 FieldColorPaletteSize = UE_ARRAY_COUNT(FieldColorPalette);
+
+// 会话级导出限流（控制台可调）
+static TAutoConsoleVariable<int32> CVarMermaidMaxExportsPerSession(
+	TEXT("SagaStats.Mermaid.MaxExportsPerSession"),
+	100,
+	TEXT("本次运行最多导出的 Mermaid DAG 文件数（<= 0 = 不限）"));
+
+static TAutoConsoleVariable<float> CVarMermaidSampleRate(
+	TEXT("SagaStats.Mermaid.SampleRate"),
+	1.f,
+	TEXT("Execute 触发 Mermaid 导出的采样率（0~1）"));
+
+namespace
+{
+	/** 导出快照：只含格式化需要的字符串与下标，后台任务不接触 UObject */
+	struct FMermaidRuleSnapshot
+	{
+		FString Name;
+
+		/** Condition 显示串；空 = 无 Condition */
+		FString Condition;
+
+		/** 产出的 Effect 类型名；空 = 无产出 */
+		FString Produces;
+
+		bool bExecuted = false;
+
+		/** 消费的 (类型名, 产出者 Rule 下标)；INDEX_NONE = 外部输入 */
+		TArray<TPair<FString, int32>> Consumed;
+	};
+
+	struct FMermaidEffectSnapshot
+	{
+		FString TypeName;
+
+		/** 产出者 Rule 下标；INDEX_NONE = 攻击上下文等外部输入 */
+		int32 Producer = INDEX_NONE;
+	};
+
+	struct FMermaidDAGSnapshot
+	{
+		FString Label;
+		FDateTime Timestamp;
+		uint32 Signature = 0;
+		TArray<FMermaidRuleSnapshot> Rules;
+		bool bHasContext = false;
+		TArray<FMermaidEffectSnapshot> Effects;
+	};
+
+	/** 会话级去重与计数（只在游戏线程访问） */
+	TSet<uint32> GExportedMermaidSignatures;
+	int32 GMermaidExportCount = 0;
+
+	FString BuildMermaidText(const FMermaidDAGSnapshot& Snapshot);
+	void WriteMermaidFile(const FMermaidDAGSnapshot& Snapshot, const FString& Text);
+}
+
+void UDamagePipeline::ExportMermaidDAG(
+	const TArray<FRuleExecutionEntry>& ExecutionLog,
+	const FDamageContext* Context) const
+{
+	TMap<FName, bool> ExecStatusMap;
+	for (const FRuleExecutionEntry& Entry : ExecutionLog)
+	{
+		ExecStatusMap.Add(Entry.RuleName, Entry.bExecuted);
+	}
+
+	FDamageExecutionResult Result;
+	Result.Reset(CompiledPlan->Rules.Num());
+	for (int32 RuleIndex = 0; RuleIndex < CompiledPlan->Rules.Num(); ++RuleIndex)
+	{
+		const bool* bExec = ExecStatusMap.Find(CompiledPlan->Rules[RuleIndex].Rule->GetFName());
+		Result.Executed[RuleIndex] = bExec && *bExec;
+	}
+	ExportMermaidDAG(Result, Context);
+}
+
+void UDamagePipeline::ExportMermaidDAG(const FDamageExecutionResult& Result, const FDamageContext* Context) const
+{
+	// 限流状态与 CVar 只在游戏线程访问；其他线程上的执行不导出
+	if (!IsInGameThread())
+	{
+		static std::atomic<bool> bWarned{ false };
+		if (!bWarned.exchange(true))
+		{
+			UE_LOG(LogSagaStats, Log, TEXT("Pipeline %s: 非游戏线程上的执行不导出 Mermaid DAG"), *GetName());
+		}
+		return;
+	}
+
+	// ---- 限流：采样率 + 会话上限 ----
+	const float SampleRate = CVarMermaidSampleRate.GetValueOnGameThread();
+	if (SampleRate < 1.f && FMath::FRand() >= SampleRate)
+	{
+		return;
+	}
+
+	const int32 MaxExports = CVarMermaidMaxExportsPerSession.GetValueOnGameThread();
+	if (MaxExports > 0 && GMermaidExportCount >= MaxExports)
+	{
+		return;
+	}
+
+	// ---- 签名去重：(Rule 集合, 执行掩码, Effect 类型集合) 相同的命中只导出一次 ----
+	// 直接取自执行位图与 Context 存在位：稳态的重复命中到此为止，不构造日志与快照
+	const int32 NumRules = CompiledPlan->Rules.Num();
+	uint32 Signature = GetTypeHash(NumRules);
+	for (int32 RuleIndex = 0; RuleIndex < NumRules; ++RuleIndex)
+	{
+		Signature = HashCombineFast(Signature, GetTypeHash(CompiledPlan->Rules[RuleIndex].Rule));
+		Signature = HashCombineFast(Signature, GetTypeHash(Result.WasExecuted(RuleIndex)));
+	}
+	if (Context)
+	{
+		Signature = HashCombineFast(Signature, Context->HashEffectTypes());
+	}
+
+	bool bAlreadyExported = false;
+	GExportedMermaidSignatures.Add(Signature, &bAlreadyExported);
+	if (bAlreadyExported)
+	{
+		return;
+	}
+	++GMermaidExportCount;
+
+	// ---- 快照（游戏线程：读取 UObject）----
+	TArray<const UDamageRule*, TInlineAllocator<32>> Rules;
+	for (const FCompiledDamageRule& Compiled : CompiledPlan->Rules)
+	{
+		Rules.Add(Compiled.Rule);
+	}
+
+	TArray<FConstStructView> Effects;
+	if (Context)
+	{
+		Effects = Context->GetAllDamageEffects();
+	}
+
+	FMermaidDAGSnapshot Snapshot;
+	Snapshot.Label = ScenarioLabel.IsEmpty() ? TEXT("Damage Pipeline") : ScenarioLabel;
+	Snapshot.Timestamp = FDateTime::Now();
+	Snapshot.Signature = Signature;
+
+	// EffectType→DamageRule 下标映射用于依赖连线
+	TMap<const UScriptStruct*, int32> EffectTypeToProducer;
+	for (int32 i = 0; i < Rules.Num(); ++i)
+	{
+		if (const UScriptStruct* FT = Rules[i]->GetProducesEffectType())
+		{
+			EffectTypeToProducer.Add(FT, i);
+		}
+	}
+
+	Snapshot.Rules.Reserve(Rules.Num());
+	for (int32 RuleIndex = 0; RuleIndex < Rules.Num(); ++RuleIndex)
+	{
+		const UDamageRule* Rule = Rules[RuleIndex];
+		FMermaidRuleSnapshot& RuleSnapshot = Snapshot.Rules.AddDefaulted_GetRef();
+		RuleSnapshot.Name = Rule->GetName();
+		RuleSnapshot.Condition = Rule->Condition ? Rule->Condition->GetDisplayString() : FString();
+		RuleSnapshot.Produces = Rule->GetProducesEffectType() ? Rule->GetProducesEffectType()->GetName() : FString();
+		RuleSnapshot.bExecuted = Result.WasExecuted(RuleIndex);
+
+		for (UScriptStruct* Type : Rule->GetConsumedEffectTypes())
+		{
+			const int32* Producer = EffectTypeToProducer.Find(Type);
+			RuleSnapshot.Consumed.Add({Type ? Type->GetName() : TEXT("?"), Producer ? *Producer : INDEX_NONE});
+		}
+	}
+
+	Snapshot.bHasContext = Context != nullptr;
+	for (const FConstStructView& Effect : Effects)
+	{
+		const UScriptStruct* EffectType = Effect.GetScriptStruct();
+		FMermaidEffectSnapshot& EffectSnapshot = Snapshot.Effects.AddDefaulted_GetRef();
+		EffectSnapshot.TypeName = EffectType ? EffectType->GetName() : TEXT("null");
+		const int32* Producer = EffectTypeToProducer.Find(EffectType);
+		EffectSnapshot.Producer = Producer ? *Producer : INDEX_NONE;
+	}
+
+	// ---- 格式化与写盘（后台任务）----
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [Snapshot = MoveTemp(Snapshot)]()
+	{
+		WriteMermaidFile(Snapshot, BuildMermaidText(Snapshot));
+	});
+}
+
+namespace
+{
+	FString BuildMermaidText(const FMermaidDAGSnapshot& Snapshot)
+	{
+		const TArray<FMermaidRuleSnapshot>& Rules = Snapshot.Rules;
+
+		// DamageRule 间依赖的颜色分配（以 DamageRule 为单位着色）
+		auto RuleColor = [](int32 RuleIndex) { return FieldColorPalette[RuleIndex % FieldColorPaletteSize]; };
+
+		// ---- 构造多行 label 的 helper ----
+		// 在节点内多行 label 下，每行 pad 到相同 visual 字符数——配合 monospace 字体，
+		// Mermaid 默认居中对齐会让所有行 bounding box 等宽，文字视觉上从同一 X 左对齐。
+		// ASCII 树字符（├─ └─ │）的缩进层级因此能正确显示。
+		//
+		// Lines: TArray<TPair<Text, VisualLen>>
+		//   Text 可含 HTML 标签（<font> / <b>），VisualLen 是渲染字符数（不含标签）
+		auto BuildPaddedLabel = [](const TArray<TPair<FString, int32>>& Lines) -> FString
+		{
+			int32 MaxVL = 0;
+			for (const auto& L : Lines) MaxVL = FMath::Max(MaxVL, L.Value);
+
+			FString Out;
+			for (int32 i = 0; i < Lines.Num(); ++i)
+			{
+				if (i > 0) Out += TEXT("<br/>");
+				Out += Lines[i].Key;
+				const int32 Pad = MaxVL - Lines[i].Value;
+				for (int32 p = 0; p < Pad; ++p)
+				{
+					// U+00A0 NO-BREAK SPACE —— monospace 下占 1 字宽；
+					// 避免 Mermaid 把空格合并 / 把 &nbsp; 错误转义
+					Out += TEXT("\u00A0");
+				}
+			}
+			return Out;
+		};
+
+		// ---- 生成 Mermaid ----
+		FString M;
+		M.Reserve(4096);
+
+		// 注入 monospace 字体（节点内 ASCII 树缩进需要等宽字符）
+		M += TEXT("%%{init: {'themeVariables': {'fontFamily': 'monospace'}}}%%\n");
+		M += TEXT("graph LR\n");
+
+		M += FString::Printf(TEXT("    %%%% %s - %s\n\n"), *Snapshot.Label, *Snapshot.Timestamp.ToString());
+
+		M += TEXT("    classDef exec fill:#d4edda,stroke:#28a745,color:#000\n");
+		M += TEXT("    classDef skip fill:#e2e3e5,stroke:#6c757d,color:#666\n");
+		M += TEXT("    classDef initCtx fill:#fff3cd,stroke:#ffc107,color:#000\n");
+		M += TEXT("    classDef finalCtx fill:#cce5ff,stroke:#004085,color:#000\n\n");
+
+		// DC Init 节点（显示非 DamageRule 产出的 Effect = 攻击上下文）
+		bool bHasInitialEffects = false;
+		if (Snapshot.bHasContext)
+		{
+			TArray<TPair<FString, int32>> InitLines;
+			const FString HeaderText = TEXT("<b>DC Initial</b>");
+			const int32 HeaderVL = 10; // "DC Initial"
+			InitLines.Add({HeaderText, HeaderVL});
+
+			for (const FMermaidEffectSnapshot& Effect : Snapshot.Effects)
+			{
+				if (Effect.Producer == INDEX_NONE)
+				{
+					FString Line = FString::Printf(TEXT("[%s]"), *Effect.TypeName);
+					InitLines.Add({Line, Line.Len()});
+					bHasInitialEffects = true;
+				}
+			}
+			if (bHasInitialEffects)
+			{
+				M += FString::Printf(TEXT("    DC_Init[\"%s\"]:::initCtx\n\n"), *BuildPaddedLabel(InitLines));
+			}
+		}
+
+		// DamageRule 节点
+		for (int32 i = 0; i < Rules.Num(); i++)
+		{
+			const FMermaidRuleSnapshot& Rule = Rules[i];
+			const TCHAR* StyleClass = Rule.bExecuted ? TEXT("exec") : TEXT("skip");
+
+			// 收集所有行到 (Text, VisualLen) 列表，最后 BuildPaddedLabel 统一 pad
+			TArray<TPair<FString, int32>> Lines;
+
+			// 标题行（格式与 Graph Editor 节点一致：1-based 序号 + RuleName）
+			{
+				FString Title = FString::Printf(TEXT("%d. %s"), i + 1, *Rule.Name);
+				Lines.Add({Title, Title.Len()});
+			}
+
+			// Condition 行（可能多行 —— ASCII 树按 \n 拆）
+			if (!Rule.Condition.IsEmpty())
+			{
+				FString Raw = Rule.Condition;
+				Raw.ReplaceInline(TEXT("\""), TEXT("#quot;"));
+
+				TArray<FString> CondLines;
+				Raw.ParseIntoArray(CondLines, TEXT("\n"), /*CullEmpty=*/false);
+
+				for (int32 j = 0; j < CondLines.Num(); ++j)
+				{
+					// 首行加 "Cond: " 前缀，后续行加等宽空格让 ASCII 树缩进对齐
+					FString LineText = (j == 0 ? TEXT("Cond: ") : TEXT("      ")) + CondLines[j];
+					Lines.Add({LineText, LineText.Len()});
+				}
+			}
+			else
+			{
+				FString LineText = TEXT("Cond: (none)");
+				Lines.Add({LineText, LineText.Len()});
+			}
+
+			// Produces: 行
+			{
+				FString T = TEXT("Produces:");
+				Lines.Add({T, T.Len()});
+			}
+
+			// Effect 行
+			if (!Rule.Produces.IsEmpty())
+			{
+				// <font> 标签不计入 VisualLen；■ 占 1 字宽 + 空格 1 字宽
+				FString T = FString::Printf(TEXT("<font color='%s'>#9632;</font> %s"),
+					RuleColor(i), *Rule.Produces);
+				int32 VL = 1 /*■*/ + 1 /*space*/ + Rule.Produces.Len();
+				Lines.Add({T, VL});
+			}
+			else
+			{
+				Lines.Add({TEXT("(none)"), 6});
+			}
+
+			M += FString::Printf(TEXT("    %s[\"%s\"]:::%s\n"),
+				*Rule.Name, *BuildPaddedLabel(Lines), StyleClass);
+		}
+
+		M += TEXT("\n");
+
+		// 连线
+		int32 LinkIndex = 0;
+		struct FColoredLink { int32 Index; const TCHAR* Color; };
+		TArray<FColoredLink> ColoredLinks;
+
+		// 隐藏执行顺序链
+		if (bHasInitialEffects && Rules.Num() > 0)
+		{
+			M += FString::Printf(TEXT("    DC_Init ~~~ %s\n"), *Rules[0].Name);
+			LinkIndex++;
+		}
+		for (int32 i = 0; i + 1 < Rules.Num(); i++)
+		{
+			M += FString::Printf(TEXT("    %s ~~~ %s\n"), *Rules[i].Name, *Rules[i + 1].Name);
+			LinkIndex++;
+		}
+		if (Rules.Num() > 0)
+		{
+			M += FString::Printf(TEXT("    %s ~~~ DC_Final\n"), *Rules.Last().Name);
+			LinkIndex++;
+		}
+		M += TEXT("\n");
+
+		// 产销依赖连线（EffectType 匹配）
+		for (const FMermaidRuleSnapshot& Rule : Rules)
+		{
+			for (const TPair<FString, int32>& Consumed : Rule.Consumed)
+			{
+				if (Consumed.Value != INDEX_NONE)
+				{
+					M += FString::Printf(TEXT("    %s -->|%s| %s\n"),
+						*Rules[Consumed.Value].Name, *Consumed.Key, *Rule.Name);
+					ColoredLinks.Add({LinkIndex, RuleColor(Consumed.Value)});
+				}
+				else if (bHasInitialEffects)
+				{
+					M += FString::Printf(TEXT("    DC_Init -->|%s| %s\n"), *Consumed.Key, *Rule.Name);
+				}
+				else { continue; }
+
+				LinkIndex++;
+			}
+		}
+
+		M += TEXT("\n");
+
+		// linkStyle 着色
+		for (const FColoredLink& Link : ColoredLinks)
+		{
+			M += FString::Printf(TEXT("    linkStyle %d stroke:%s,stroke-width:2px\n"), Link.Index, Link.Color);
+		}
+
+		M += TEXT("\n");
+
+		// DC Final 节点（所有 DamageRule 产出的 Effect + 攻击上下文）
+		if (Snapshot.bHasContext)
+		{
+			TArray<TPair<FString, int32>> FinalLines;
+			FinalLines.Add({TEXT("<b>DC Final</b>"), 8 /* "DC Final" */});
+
+			for (const FMermaidEffectSnapshot& Effect : Snapshot.Effects)
+			{
+				// 查找产出此 Effect 的 DamageRule（攻击上下文无 producer）
+				FString Line = Effect.Producer != INDEX_NONE
+					? FString::Printf(TEXT("%s: %s"), *Rules[Effect.Producer].Name, *Effect.TypeName)
+					: FString::Printf(TEXT("[ctx] %s"), *Effect.TypeName);
+				FinalLines.Add({Line, Line.Len()});
+			}
+
+			if (FinalLines.Num() == 1)
+			{
+				FinalLines.Add({TEXT("(empty)"), 7});
+			}
+			M += FString::Printf(TEXT("    DC_Final[\"%s\"]:::finalCtx\n"), *BuildPaddedLabel(FinalLines));
+		}
+
+		M += TEXT("\n");
+		return M;
+	}
+
+	void WriteMermaidFile(const FMermaidDAGSnapshot& Snapshot, const FString& Text)
+	{
+		// 文件名带签名：同一秒内的不同命中模式不会互相覆盖
+		FString SafeLabel = Snapshot.Label.Replace(TEXT(" "), TEXT("_")).Replace(TEXT("."), TEXT("_"));
+		FString FileName = FString::Printf(TEXT("DR_DAG_%s_%s_%08x.mmd"),
+			*SafeLabel, *Snapshot.Timestamp.ToString(TEXT("%Y%m%d_%H%M%S")), Snapshot.Signature);
+		FString FilePath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Graphs"), FileName);
+
+		FString DirPath = FPaths::GetPath(FilePath);
+		if (!FPlatformFileManager::Get().GetPlatformFile().DirectoryExists(*DirPath))
+		{
+			FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*DirPath);
+		}
+
+		if (FFileHelper::SaveStringToFile(Text, *FilePath, FFileHelper::EEncodingOptions::ForceUTF8))
+		{
+			UE_LOG(LogSagaStats, Log, TEXT("Mermaid DAG 已保存: %s"), *FilePath);
+		}
+		else
+		{
+			UE_LOG(LogSagaStats, Error, TEXT("Mermaid DAG 保存失败: %s"), *FilePath);
+		}
 	}
 }
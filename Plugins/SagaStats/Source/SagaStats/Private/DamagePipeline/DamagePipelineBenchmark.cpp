@@ -0,0 +1,134 @@
+/***************************************************************************************************************
+* Plugin:       SagaStats
+* Author:       Jinming Zhang
+* Description:  SagaStats offers modular damage process and meter systems to support adaptable status management
+****************************************************************************************************************/
+
+// DamagePipelineBenchmark.cpp — 构建期性能基准（控制台命令，非 Shipping）
+#include "DamagePipeline/CompiledDamagePipeline.h"
+#include "SagaStatsLog.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace
+{
+	/**
+	 * 合成 Pipeline 依赖图：每条 Rule 从前 Window 条 Rule 中随机选至多 MaxFanIn 个上游，
+	 * 模拟产销关系集中在局部的真实管线（Sekiro 一类的 Mixup → Guard → Hurt 链 + 少量跨段依赖）。
+	 * 额外走一遍 EffectType → 生产者的哈希查找，与 StableTopologicalSort 的建图开销对齐。
+	 */
+	void BuildSyntheticGraph(int32 NumRules, FRandomStream& Random, FDamageRuleGraph& OutGraph)
+	{
+		constexpr int32 Window = 64;
+		constexpr int32 MaxFanIn = 3;
+
+		TMap<int32, int32> ProducerIndex;
+		ProducerIndex.Reserve(NumRules);
+		for (int32 i = 0; i < NumRules; ++i)
+		{
+			ProducerIndex.Add(i, i);
+		}
+
+		TArray<int32> LastConsumer;
+		LastConsumer.Init(INDEX_NONE, NumRules);
+
+		OutGraph.Reset(NumRules, NumRules * MaxFanIn);
+		for (int32 i = 0; i < NumRules; ++i)
+		{
+			OutGraph.BeginNode();
+			const int32 FanIn = i > 0 ? Random.RandRange(0, MaxFanIn) : 0;
+			for (int32 k = 0; k < FanIn; ++k)
+			{
+				const int32 ConsumedType = Random.RandRange(FMath::Max(0, i - Window), i - 1);
+				const int32 Producer = ProducerIndex.FindChecked(ConsumedType);
+				if (LastConsumer[Producer] != i)
+				{
+					LastConsumer[Producer] = i;
+					OutGraph.AddDependency(Producer);
+				}
+			}
+		}
+		OutGraph.Finalize();
+	}
+
+	/** 校验排序结果：覆盖全部节点、每条边上游在前 */
+	bool ValidateOrder(const FDamageRuleGraph& Graph, TConstArrayView<int32> Order)
+	{
+		if (Order.Num() != Graph.Num())
+		{
+			return false;
+		}
+
+		TArray<int32> Position;
+		Position.Init(INDEX_NONE, Graph.Num());
+		for (int32 i = 0; i < Order.Num(); ++i)
+		{
+			Position[Order[i]] = i;
+		}
+		for (int32 Node = 0; Node < Graph.Num(); ++Node)
+		{
+			for (int32 Upstream : Graph.GetDependencies(Node))
+			{
+				if (Position[Upstream] == INDEX_NONE || Position[Upstream] > Position[Node])
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	void RunSortBenchmark(const TArray<FString>& Args)
+	{
+		const int32 Iterations = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 20;
+		const int32 Sizes[] = { 100, 1000, 10000 };
+
+		UE_LOG(LogSagaStats, Log, TEXT("DamagePipeline 排序基准（每档 %d 次，取最小 / 平均）"), Iterations);
+
+		for (int32 NumRules : Sizes)
+		{
+			FRandomStream Random(NumRules);
+			FDamageRuleGraph Graph;
+			TArray<int32> Order;
+
+			double BuildMin = DBL_MAX, BuildTotal = 0.0;
+			double SortMin = DBL_MAX, SortTotal = 0.0;
+			bool bValid = true;
+
+			for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+			{
+				Random.Reset();
+
+				const double BuildStart = FPlatformTime::Seconds();
+				BuildSyntheticGraph(NumRules, Random, Graph);
+				const double BuildTime = FPlatformTime::Seconds() - BuildStart;
+
+				const double SortStart = FPlatformTime::Seconds();
+				bValid &= Graph.StableSort(Order);
+				const double SortTime = FPlatformTime::Seconds() - SortStart;
+
+				BuildMin = FMath::Min(BuildMin, BuildTime);
+				BuildTotal += BuildTime;
+				SortMin = FMath::Min(SortMin, SortTime);
+				SortTotal += SortTime;
+			}
+
+			bValid &= ValidateOrder(Graph, Order);
+
+			UE_LOG(LogSagaStats, Log, TEXT("  %6d Rules / %6d 边：建图 %.3f / %.3f ms，排序 %.3f / %.3f ms%s"),
+				NumRules, Graph.Dependencies.Num(),
+				BuildMin * 1000.0, BuildTotal * 1000.0 / Iterations,
+				SortMin * 1000.0, SortTotal * 1000.0 / Iterations,
+				bValid ? TEXT("") : TEXT("  [排序结果无效！]"));
+		}
+	}
+}
+
+static FAutoConsoleCommand DamagePipelineSortBenchmarkCommand(
+	TEXT("SagaStats.DamagePipeline.BenchmarkSort"),
+	TEXT("对 100 / 1k / 10k 条 Rule 的合成依赖图计时建图与稳定拓扑排序。参数：[每档迭代次数=20]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&RunSortBenchmark));
+
+#endif
@@ -0,0 +1,175 @@
+/***************************************************************************************************************
+* Plugin:       SagaStats
+* Author:       Jinming Zhang
+* Description:  SagaStats offers modular damage process and meter systems to support adaptable status management
+****************************************************************************************************************/
+
+// DamagePipelinePlanCache.cpp — 编译计划缓存：键计算 + LRU 淘汰
+#include "DamagePipeline/DamagePipelinePlanCache.h"
+#include "DamagePipeline/CompiledDamagePipeline.h"
+#include "DamagePipeline/DamageRule.h"
+#include "SagaStatsLog.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarPlanCacheCapacity(
+	TEXT("SagaStats.DamagePipeline.PlanCacheCapacity"),
+	512,
+	TEXT("全局编译计划缓存的条目上限（超出时按 LRU 淘汰无人使用的条目；<= 0 = 不缓存）"));
+
+static FAutoConsoleCommand PlanCacheStatsCommand(
+	TEXT("SagaStats.DamagePipeline.PlanCacheStats"),
+	TEXT("输出全局编译计划缓存的条目数与命中率"),
+	FConsoleCommandDelegate::CreateLambda([]() { FDamagePipelinePlanCache::Get().LogStats(); }));
+
+// ============================================================================
+// 缓存键
+// ============================================================================
+
+FDamagePlanKey FDamagePlanKey::Make(TConstArrayView<TObjectPtr<UDamageRule>> DamageRules,
+	TConstArrayView<TObjectPtr<UScriptStruct>> ObservedEffects)
+{
+	FDamagePlanKey Key;
+	Key.Rules.Reserve(DamageRules.Num());
+	for (const TObjectPtr<UDamageRule>& Rule : DamageRules)
+	{
+		if (!Rule) continue;
+
+		Key.Rules.Add(Rule);
+		Key.ContentHash = HashCombineFast(Key.ContentHash, PointerHash(Rule.Get()));
+		Key.ContentHash = HashCombineFast(Key.ContentHash, FCompiledDamagePipeline::HashOperationDeclaration(Rule->OperationClass));
+		Key.ContentHash = HashCombineFast(Key.ContentHash, FCompiledDamagePipeline::HashPredicateContent(Rule->Condition));
+	}
+
+	// 观测集合决定裁剪结果
+	for (const TObjectPtr<UScriptStruct>& Type : ObservedEffects)
+	{
+		if (!Type) continue;
+
+		Key.ObservedEffects.Add(Type);
+		Key.ContentHash = HashCombineFast(Key.ContentHash, PointerHash(Type.Get()));
+	}
+	return Key;
+}
+
+// ============================================================================
+// 查找 / 加入 / 淘汰
+// ============================================================================
+
+FDamagePipelinePlanCache& FDamagePipelinePlanCache::Get()
+{
+	static FDamagePipelinePlanCache Instance;
+	return Instance;
+}
+
+TSharedPtr<FCompiledDamagePipeline> FDamagePipelinePlanCache::Find(const FDamagePlanKey& Key)
+{
+	check(IsInGameThread());
+
+	if (auto* Bucket = Buckets.Find(Key.ContentHash))
+	{
+		for (FEntry& Entry : *Bucket)
+		{
+			if (Entry.Key == Key)
+			{
+				Entry.LastUsed = ++UseClock;
+				++NumHits;
+				return Entry.Plan;
+			}
+		}
+	}
+
+	++NumMisses;
+	return nullptr;
+}
+
+void FDamagePipelinePlanCache::Add(const FDamagePlanKey& Key, const TSharedRef<FCompiledDamagePipeline>& Plan)
+{
+	check(IsInGameThread());
+
+	const int32 Capacity = CVarPlanCacheCapacity.GetValueOnGameThread();
+	if (Capacity <= 0)
+	{
+		return;
+	}
+
+	auto& Bucket = Buckets.FindOrAdd(Key.ContentHash);
+	for (FEntry& Entry : Bucket)
+	{
+		if (Entry.Key == Key)
+		{
+			Entry.Plan = Plan;
+			Entry.LastUsed = ++UseClock;
+			return;
+		}
+	}
+
+	Bucket.Add(FEntry{ Key, Plan, ++UseClock });
+	++NumEntries;
+
+	if (NumEntries > Capacity)
+	{
+		EvictUnused(Capacity);
+	}
+}
+
+void FDamagePipelinePlanCache::EvictUnused(int32 Capacity)
+{
+	while (NumEntries > Capacity)
+	{
+		// 条目数为数百量级，线性扫描即可；只有缓存自身持有引用的条目可淘汰
+		uint32 OldestHash = 0;
+		int32 OldestIndex = INDEX_NONE;
+		uint64 OldestUse = MAX_uint64;
+		for (const auto& Pair : Buckets)
+		{
+			for (int32 Index = 0; Index < Pair.Value.Num(); ++Index)
+			{
+				const FEntry& Entry = Pair.Value[Index];
+				if (Entry.Plan.GetSharedReferenceCount() == 1 && Entry.LastUsed < OldestUse)
+				{
+					OldestHash = Pair.Key;
+					OldestIndex = Index;
+					OldestUse = Entry.LastUsed;
+				}
+			}
+		}
+
+		if (OldestIndex == INDEX_NONE)
+		{
+			// 全部在用：暂时超出容量，下次加入时再淘汰
+			return;
+		}
+
+		auto& Bucket = Buckets.FindChecked(OldestHash);
+		Bucket.RemoveAtSwap(OldestIndex);
+		if (Bucket.Num() == 0)
+		{
+			Buckets.Remove(OldestHash);
+		}
+		--NumEntries;
+	}
+}
+
+void FDamagePipelinePlanCache::Empty()
+{
+	Buckets.Empty();
+	NumEntries = 0;
+}
+
+void FDamagePipelinePlanCache::LogStats() const
+{
+	const uint64 NumLookups = NumHits + NumMisses;
+	UE_LOG(LogSagaStats, Log, TEXT("DamagePipeline 计划缓存: %d 条，命中 %llu / %llu（%.1f%%）"),
+		NumEntries, NumHits, NumLookups, NumLookups > 0 ? 100.0 * NumHits / NumLookups : 0.0);
+}
+
+void FDamagePipelinePlanCache::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (auto& Pair : Buckets)
+	{
+		for (FEntry& Entry : Pair.Value)
+		{
+			Entry.Plan->AddReferencedObjects(Collector);
+		}
+	}
+}
@@ -14,10 +14,14 @@
 // C++ 模板的非模板补充
 // ============================================================================
 
-const TMap<TObjectPtr<UScriptStruct>, FInstancedStruct>& UDamagePipelineResults::GetAllEffects(const UDamageContext* Context)
+TArray<FConstStructView> UDamagePipelineResults::GetAllEffects(const UDamageContext* Context)
 {
-	static const TMap<TObjectPtr<UScriptStruct>, FInstancedStruct> Empty;
-	return Context ? Context->GetAllDamageEffects() : Empty;
+	return Context ? Context->GetAllDamageEffects() : TArray<FConstStructView>();
+}
+
+TArray<FConstStructView> UDamagePipelineResults::GetAllEffects(const FDamageContext* Context)
+{
+	return Context ? Context->GetAllDamageEffects() : TArray<FConstStructView>();
 }
 
 // ============================================================================
@@ -119,7 +123,7 @@ DEFINE_FUNCTION(UDamagePipelineResults::execReadEffect)
 	else
 	{
 		P_NATIVE_BEGIN;
-		FInstancedStruct Found = DC->GetEffectByType(ValueProp->Struct);
+		const FConstStructView Found = DC->GetEffectViewByType(ValueProp->Struct);
 		if (Found.IsValid() && Found.GetScriptStruct()->IsChildOf(ValueProp->Struct))
 		{
 			ValueProp->Struct->CopyScriptStruct(ValuePtr, Found.GetMemory());
@@ -0,0 +1,238 @@
+/***************************************************************************************************************
+* Plugin:       SagaStats
+* Author:       Jinming Zhang
+* Description:  SagaStats offers modular damage process and meter systems to support adaptable status management
+****************************************************************************************************************/
+
+// DamagePipelineTrace.cpp — 每线程无锁环形缓冲 + 异步导出
+#include "DamagePipeline/DamagePipelineTrace.h"
+#include "SagaStatsLog.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Tasks/Task.h"
+#include "Algo/StableSort.h"
+#include <atomic>
+
+namespace
+{
+	/**
+	 * 单生产者（所属线程）/ 单消费者（Drain，持 RegistryLock）环形缓冲。
+	 * Head 只由生产者推进、Tail 只由消费者推进，各自 release 发布，对方 acquire 读取。
+	 */
+	struct FDamageTraceRing
+	{
+		static constexpr uint32 Capacity = 4096;
+		static constexpr uint32 Mask = Capacity - 1;
+		static_assert((Capacity & Mask) == 0, "Capacity 必须是 2 的幂");
+
+		std::atomic<uint32> Head{0};
+		std::atomic<uint32> Tail{0};
+		FDamageTraceRecord Records[Capacity];
+
+		bool Push(const FDamageTraceRecord& Record)
+		{
+			const uint32 H = Head.load(std::memory_order_relaxed);
+			const uint32 T = Tail.load(std::memory_order_acquire);
+			if (H - T >= Capacity)
+			{
+				return false;
+			}
+			Records[H & Mask] = Record;
+			Head.store(H + 1, std::memory_order_release);
+			return true;
+		}
+
+		void PopAll(TArray<FDamageTraceRecord>& Out)
+		{
+			uint32 T = Tail.load(std::memory_order_relaxed);
+			const uint32 H = Head.load(std::memory_order_acquire);
+			for (; T != H; ++T)
+			{
+				Out.Add(Records[T & Mask]);
+			}
+			Tail.store(T, std::memory_order_release);
+		}
+	};
+
+	struct FPipelineTraceNames
+	{
+		FString PipelineName;
+		TArray<FName> RuleNames;
+	};
+
+	/** 环注册表与名表；只在线程首次写入、编译、导出时加锁，热路径不碰 */
+	FCriticalSection RegistryLock;
+	TArray<TUniquePtr<FDamageTraceRing>> Rings;
+	TMap<uint32, FPipelineTraceNames> PipelineNames;
+	std::atomic<uint32> DroppedCount{0};
+
+	FDamageTraceRing& GetThreadRing()
+	{
+		static thread_local FDamageTraceRing* ThreadRing = nullptr;
+		if (!ThreadRing)
+		{
+			// 线程退出后环仍留在注册表中，剩余记录照常导出
+			FScopeLock Lock(&RegistryLock);
+			ThreadRing = Rings.Add_GetRef(MakeUnique<FDamageTraceRing>()).Get();
+		}
+		return *ThreadRing;
+	}
+
+	/** 导出快照：记录 + 导出时刻的名表（供后台任务脱离注册表格式化） */
+	struct FDamageTraceSnapshot
+	{
+		TArray<FDamageTraceRecord> Records;
+		TMap<uint32, FPipelineTraceNames> Names;
+	};
+
+	FDamageTraceSnapshot TakeSnapshot()
+	{
+		FDamageTraceSnapshot Snapshot;
+		FDamagePipelineTrace::Drain(Snapshot.Records);
+		FScopeLock Lock(&RegistryLock);
+		for (const FDamageTraceRecord& Record : Snapshot.Records)
+		{
+			if (!Snapshot.Names.Contains(Record.PipelineId))
+			{
+				if (const FPipelineTraceNames* Names = PipelineNames.Find(Record.PipelineId))
+				{
+					Snapshot.Names.Add(Record.PipelineId, *Names);
+				}
+			}
+		}
+		return Snapshot;
+	}
+
+	void ResolveNames(const FDamageTraceSnapshot& Snapshot, const FDamageTraceRecord& Record, FString& OutPipeline, FString& OutRule)
+	{
+		const FPipelineTraceNames* Names = Snapshot.Names.Find(Record.PipelineId);
+		OutPipeline = Names ? Names->PipelineName : FString::Printf(TEXT("Pipeline#%u"), Record.PipelineId);
+		OutRule = Names && Names->RuleNames.IsValidIndex(Record.RuleIndex)
+			? Names->RuleNames[Record.RuleIndex].ToString()
+			: FString::Printf(TEXT("Rule#%u"), Record.RuleIndex);
+	}
+}
+
+// ============================================================================
+// 写入
+// ============================================================================
+
+void FDamagePipelineTrace::RecordRule(uint32 PipelineId, uint32 ContextId, int32 RuleIndex, bool bExecuted, uint64 StartCycles, bool bTimed)
+{
+	FDamageTraceRecord Record;
+	Record.StartCycles = StartCycles;
+	Record.PipelineId = PipelineId;
+	Record.ContextId = ContextId;
+	Record.DurationCycles = bTimed ? static_cast<uint32>(FPlatformTime::Cycles64() - StartCycles) : 0;
+	Record.RuleIndex = static_cast<uint16>(RuleIndex);
+	Record.Outcome = bExecuted ? EDamageTraceOutcome::Executed : EDamageTraceOutcome::Skipped;
+
+	if (!GetThreadRing().Push(Record))
+	{
+		DroppedCount.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void FDamagePipelineTrace::RegisterPipeline(uint32 PipelineId, const FString& PipelineName, TArray<FName>&& RuleNames)
+{
+	FScopeLock Lock(&RegistryLock);
+	FPipelineTraceNames& Names = PipelineNames.FindOrAdd(PipelineId);
+	Names.PipelineName = PipelineName;
+	Names.RuleNames = MoveTemp(RuleNames);
+}
+
+uint32 FDamagePipelineTrace::GetDroppedCount()
+{
+	return DroppedCount.load(std::memory_order_relaxed);
+}
+
+// ============================================================================
+// 导出
+// ============================================================================
+
+int32 FDamagePipelineTrace::Drain(TArray<FDamageTraceRecord>& OutRecords)
+{
+	const int32 StartNum = OutRecords.Num();
+	{
+		FScopeLock Lock(&RegistryLock);
+		for (const TUniquePtr<FDamageTraceRing>& Ring : Rings)
+		{
+			Ring->PopAll(OutRecords);
+		}
+	}
+
+	// 各线程环内有序，跨环按时间戳归并
+	TArrayView<FDamageTraceRecord> Drained = MakeArrayView(OutRecords).Slice(StartNum, OutRecords.Num() - StartNum);
+	Algo::StableSortBy(Drained, &FDamageTraceRecord::StartCycles);
+	return Drained.Num();
+}
+
+void FDamagePipelineTrace::DumpToLogAsync()
+{
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [Snapshot = TakeSnapshot()]()
+	{
+		UE_LOG(LogSagaStats, Log, TEXT("DamageTrace: %d 条记录（累计丢弃 %u）"),
+			Snapshot.Records.Num(), FDamagePipelineTrace::GetDroppedCount());
+
+		FString PipelineName, RuleName;
+		for (const FDamageTraceRecord& Record : Snapshot.Records)
+		{
+			ResolveNames(Snapshot, Record, PipelineName, RuleName);
+			UE_LOG(LogSagaStats, Log, TEXT("  [%s] %s Ctx=%u %s %.2fus"),
+				Record.Outcome == EDamageTraceOutcome::Executed ? TEXT("EXEC") : TEXT("SKIP"),
+				*PipelineName, Record.ContextId, *RuleName,
+				FPlatformTime::ToMilliseconds64(Record.DurationCycles) * 1000.0);
+		}
+	});
+}
+
+void FDamagePipelineTrace::DumpToFileAsync(const FString& FilePath)
+{
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [Snapshot = TakeSnapshot(), FilePath]()
+	{
+		FString Csv = TEXT("StartCycles,Pipeline,ContextId,RuleIndex,Rule,Outcome,DurationUs\n");
+		FString PipelineName, RuleName;
+		for (const FDamageTraceRecord& Record : Snapshot.Records)
+		{
+			ResolveNames(Snapshot, Record, PipelineName, RuleName);
+			Csv += FString::Printf(TEXT("%llu,%s,%u,%u,%s,%s,%.3f\n"),
+				Record.StartCycles, *PipelineName, Record.ContextId, Record.RuleIndex, *RuleName,
+				Record.Outcome == EDamageTraceOutcome::Executed ? TEXT("Executed") : TEXT("Skipped"),
+				FPlatformTime::ToMilliseconds64(Record.DurationCycles) * 1000.0);
+		}
+
+		if (FFileHelper::SaveStringToFile(Csv, *FilePath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+		{
+			UE_LOG(LogSagaStats, Log, TEXT("DamageTrace: %d 条记录已写入 %s"), Snapshot.Records.Num(), *FilePath);
+		}
+		else
+		{
+			UE_LOG(LogSagaStats, Error, TEXT("DamageTrace: 写入失败 %s"), *FilePath);
+		}
+	});
+}
+
+// ============================================================================
+// 控制台命令
+// ============================================================================
+
+#if SAGASTATS_DAMAGE_TRACE
+
+static FAutoConsoleCommand DamageTraceDumpCommand(
+	TEXT("SagaStats.DamageTrace.Dump"),
+	TEXT("导出 DamagePipeline 追踪记录到日志（取走后清空）"),
+	FConsoleCommandDelegate::CreateStatic(&FDamagePipelineTrace::DumpToLogAsync));
+
+static FAutoConsoleCommand DamageTraceDumpFileCommand(
+	TEXT("SagaStats.DamageTrace.DumpFile"),
+	TEXT("导出 DamagePipeline 追踪记录为 CSV（取走后清空）。参数：[文件路径]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const FString FilePath = Args.Num() > 0
+			? Args[0]
+			: FPaths::ProjectLogDir() / FString::Printf(TEXT("DamageTrace-%s.csv"), *FDateTime::Now().ToString());
+		FDamagePipelineTrace::DumpToFileAsync(FilePath);
+	}));
+
+#endif
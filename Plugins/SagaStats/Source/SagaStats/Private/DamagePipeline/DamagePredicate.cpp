@@ -12,12 +12,17 @@
 // UDamagePredicate
 // ============================================================================
 
-bool UDamagePredicate::EvaluatePredicate(const UDamageContext* Context) const
+bool UDamagePredicate::EvaluatePredicate(const FDamageContext* Context) const
 {
 	bool Result = Evaluate(Context);
 	return bReverse ? !Result : Result;
 }
 
+bool UDamagePredicate::EvaluatePredicate(const UDamageContext* Context) const
+{
+	return EvaluatePredicate(Context ? &Context->GetNativeContext() : nullptr);
+}
+
 // ============================================================================
 // ASCII 树格式辅助
 // ============================================================================
@@ -84,7 +89,7 @@ namespace
 // UDamagePredicate_Single
 // ============================================================================
 
-bool UDamagePredicate_Single::Evaluate(const UDamageContext* Context) const
+bool UDamagePredicate_Single::Evaluate(const FDamageContext* Context) const
 {
 	if (!Condition) return false;
 	return Condition->EvaluateCondition(Context);
@@ -123,7 +128,7 @@ void UDamagePredicate_Single::CollectDisplayLines(
 // UDamagePredicate_And
 // ============================================================================
 
-bool UDamagePredicate_And::Evaluate(const UDamageContext* Context) const
+bool UDamagePredicate_And::Evaluate(const FDamageContext* Context) const
 {
 	if (Predicates.Num() == 0) return false;
 	for (const auto& P : Predicates)
@@ -158,7 +163,7 @@ void UDamagePredicate_And::CollectDisplayLines(
 // UDamagePredicate_Or
 // ============================================================================
 
-bool UDamagePredicate_Or::Evaluate(const UDamageContext* Context) const
+bool UDamagePredicate_Or::Evaluate(const FDamageContext* Context) const
 {
 	if (Predicates.Num() == 0) return false;
 	for (const auto& P : Predicates)
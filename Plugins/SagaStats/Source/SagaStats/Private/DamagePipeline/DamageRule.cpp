@@ -18,9 +18,17 @@ UScriptStruct* UDamageRule::GetProducesEffectType() const
 
 TArray<UScriptStruct*> UDamageRule::GetConsumedEffectTypes() const
 {
+	TArray<UScriptStruct*> Result;
 	if (Condition)
 	{
-		return Condition->GetDependencyEffectTypes();
+		Result = Condition->GetDependencyEffectTypes();
 	}
-	return {};
+	if (OperationClass)
+	{
+		for (UScriptStruct* Type : OperationClass.GetDefaultObject()->GetConsumedEffectTypes())
+		{
+			if (Type) Result.AddUnique(Type);
+		}
+	}
+	return Result;
 }
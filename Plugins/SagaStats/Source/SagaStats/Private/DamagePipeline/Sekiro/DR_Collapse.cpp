@@ -11,15 +11,15 @@
 // Condition
 // ============================================================================
 
-bool UDamageCondition_CollapseIsCollapse::Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& ConsumedEffect) const
+bool UDamageCondition_CollapseIsCollapse::EvaluateView(const FDamageContext* Context, FConstStructView ConsumedEffect) const
 {
-	const FCollapseEffect* F = ConsumedEffect.GetPtr<FCollapseEffect>();
+	const FCollapseEffect* F = ConsumedEffect.GetPtr<const FCollapseEffect>();
 	return F ? F->bIsCollapse : false;
 }
 
-bool UDamageCondition_CollapseGuardIsCollapse::Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& ConsumedEffect) const
+bool UDamageCondition_CollapseGuardIsCollapse::EvaluateView(const FDamageContext* Context, FConstStructView ConsumedEffect) const
 {
-	const FCollapseGuardEffect* F = ConsumedEffect.GetPtr<FCollapseGuardEffect>();
+	const FCollapseGuardEffect* F = ConsumedEffect.GetPtr<const FCollapseGuardEffect>();
 	return F ? F->bIsCollapse : false;
 }
 
@@ -27,16 +27,14 @@ bool UDamageCondition_CollapseGuardIsCollapse::Evaluate_Implementation(const UDa
 // Operation
 // ============================================================================
 
-void UDamageOperation_Collapse::Execute_Implementation(UDamageContext* Context, FInstancedStruct& OutEffect)
+bool UDamageOperation_Collapse::ExecuteInPlace(FDamageContext* Context, FStructView OutEffect)
 {
-	FCollapseEffect Result;
-	Result.bIsCollapse = true;
-	OutEffect = FInstancedStruct::Make<FCollapseEffect>(Result);
+	OutEffect.Get<FCollapseEffect>().bIsCollapse = true;
+	return true;
 }
 
-void UDamageOperation_CollapseGuard::Execute_Implementation(UDamageContext* Context, FInstancedStruct& OutEffect)
+bool UDamageOperation_CollapseGuard::ExecuteInPlace(FDamageContext* Context, FStructView OutEffect)
 {
-	FCollapseGuardEffect Result;
-	Result.bIsCollapse = true;
-	OutEffect = FInstancedStruct::Make<FCollapseGuardEffect>(Result);
+	OutEffect.Get<FCollapseGuardEffect>().bIsCollapse = true;
+	return true;
 }
@@ -11,7 +11,8 @@
 // Operation
 // ============================================================================
 
-void UDamageOperation_CollapseJustGuard::Execute_Implementation(UDamageContext* Context, FInstancedStruct& OutEffect)
+bool UDamageOperation_CollapseJustGuard::ExecuteInPlace(FDamageContext* Context, FStructView OutEffect)
 {
-	OutEffect = FInstancedStruct::Make<FCollapseJustGuardEffect>(FCollapseJustGuardEffect{});
+	// 标记型 Effect：Slot 已默认初始化，存在即结果
+	return true;
 }
@@ -12,15 +12,15 @@
 // Condition
 // ============================================================================
 
-bool UDamageCondition_GuardSuccess::Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& ConsumedEffect) const
+bool UDamageCondition_GuardSuccess::EvaluateView(const FDamageContext* Context, FConstStructView ConsumedEffect) const
 {
-	const FGuardEffect* F = ConsumedEffect.GetPtr<FGuardEffect>();
+	const FGuardEffect* F = ConsumedEffect.GetPtr<const FGuardEffect>();
 	return F ? F->bGuardSuccess : false;
 }
 
-bool UDamageCondition_GuardIsJustGuard::Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& ConsumedEffect) const
+bool UDamageCondition_GuardIsJustGuard::EvaluateView(const FDamageContext* Context, FConstStructView ConsumedEffect) const
 {
-	const FGuardEffect* F = ConsumedEffect.GetPtr<FGuardEffect>();
+	const FGuardEffect* F = ConsumedEffect.GetPtr<const FGuardEffect>();
 	return F ? F->bIsJustGuard : false;
 }
 
@@ -28,12 +28,12 @@ bool UDamageCondition_GuardIsJustGuard::Evaluate_Implementation(const UDamageCon
 // Operation
 // ============================================================================
 
-void UDamageOperation_Guard::Execute_Implementation(UDamageContext* Context, FInstancedStruct& OutEffect)
+bool UDamageOperation_Guard::ExecuteInPlace(FDamageContext* Context, FStructView OutEffect)
 {
 	const FMixupEffect* Mixup = ReadEffect<FMixupEffect>(Context);
 
-	FGuardEffect Result;
+	FGuardEffect& Result = OutEffect.Get<FGuardEffect>();
 	Result.bGuardSuccess = Mixup ? Mixup->bIsGuard : false;
 	Result.bIsJustGuard = Mixup ? Mixup->bIsJustGuard : false;
-	OutEffect = FInstancedStruct::Make<FGuardEffect>(Result);
+	return true;
 }
@@ -11,9 +11,9 @@
 // Condition
 // ============================================================================
 
-bool UDamageCondition_IsHurt::Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& ConsumedEffect) const
+bool UDamageCondition_IsHurt::EvaluateView(const FDamageContext* Context, FConstStructView ConsumedEffect) const
 {
-	const FHurtEffect* F = ConsumedEffect.GetPtr<FHurtEffect>();
+	const FHurtEffect* F = ConsumedEffect.GetPtr<const FHurtEffect>();
 	return F ? F->bIsHurt : false;
 }
 
@@ -21,9 +21,8 @@ bool UDamageCondition_IsHurt::Evaluate_Implementation(const UDamageContext* Cont
 // Operation
 // ============================================================================
 
-void UDamageOperation_Hurt::Execute_Implementation(UDamageContext* Context, FInstancedStruct& OutEffect)
+bool UDamageOperation_Hurt::ExecuteInPlace(FDamageContext* Context, FStructView OutEffect)
 {
-	FHurtEffect Result;
-	Result.bIsHurt = true;
-	OutEffect = FInstancedStruct::Make<FHurtEffect>(Result);
+	OutEffect.Get<FHurtEffect>().bIsHurt = true;
+	return true;
 }
@@ -12,15 +12,15 @@
 // Condition
 // ============================================================================
 
-bool UDamageCondition_IsGuard::Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& ConsumedEffect) const
+bool UDamageCondition_IsGuard::EvaluateView(const FDamageContext* Context, FConstStructView ConsumedEffect) const
 {
-	const FMixupEffect* F = ConsumedEffect.GetPtr<FMixupEffect>();
+	const FMixupEffect* F = ConsumedEffect.GetPtr<const FMixupEffect>();
 	return F ? F->bIsGuard : false;
 }
 
-bool UDamageCondition_IsJustGuard::Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& ConsumedEffect) const
+bool UDamageCondition_IsJustGuard::EvaluateView(const FDamageContext* Context, FConstStructView ConsumedEffect) const
 {
-	const FMixupEffect* F = ConsumedEffect.GetPtr<FMixupEffect>();
+	const FMixupEffect* F = ConsumedEffect.GetPtr<const FMixupEffect>();
 	return F ? F->bIsJustGuard : false;
 }
 
@@ -28,14 +28,14 @@ bool UDamageCondition_IsJustGuard::Evaluate_Implementation(const UDamageContext*
 // Operation
 // ============================================================================
 
-void UDamageOperation_Mixup::Execute_Implementation(UDamageContext* Context, FInstancedStruct& OutEffect)
+bool UDamageOperation_Mixup::ExecuteInPlace(FDamageContext* Context, FStructView OutEffect)
 {
 	const FSekiroAttackContext* Atk = ReadEffect<FSekiroAttackContext>(Context);
-	FMixupEffect Result;
+	FMixupEffect& Result = OutEffect.Get<FMixupEffect>();
 	if (Atk)
 	{
 		Result.bIsGuard = Atk->GuardLevel > 0.f;
 		Result.bIsJustGuard = Atk->GuardLevel > Atk->DmgLevel;
 	}
-	OutEffect = FInstancedStruct::Make<FMixupEffect>(Result);
+	return true;
 }
@@ -165,43 +165,49 @@ void ADamagePipelineTestActor::RunScenario(int32 ScenarioIndex)
 void ADamagePipelineTestActor::RunScenario_NormalHit()
 {
 	Pipeline->ScenarioLabel = TEXT("1.NormalSlashHit");
-	UDamageContext* Context = NewObject<UDamageContext>(this);
+	// 逐次命中的上下文放在栈上：无 UObject 分配
+	FDamageContext Context;
 	FSekiroAttackContext Atk;
 	Atk.DmgLevel = 3.0f;
 	Atk.CurrentHP = 100.0f;
-	UDamagePipelineResults::WriteEffect<FSekiroAttackContext>(Context, Atk);
+	UDamagePipelineResults::WriteEffect<FSekiroAttackContext>(&Context, Atk);
 
-	TArray<FRuleExecutionEntry> Log = Pipeline->Execute(Context);
-	PrintScenarioResult(TEXT("1. Normal Slash Hit"), Context, Log);
+	FDamageExecutionResult Result;
+	Pipeline->ExecuteNative(&Context, Result);
+	PrintScenarioResult(TEXT("1. Normal Slash Hit"), &Context, Pipeline->MakeExecutionLog(Result));
 }
 
 void ADamagePipelineTestActor::RunScenario_Guard()
 {
 	Pipeline->ScenarioLabel = TEXT("2.Guard");
-	UDamageContext* Context = NewObject<UDamageContext>(this);
+	// 逐次命中的上下文放在栈上：无 UObject 分配
+	FDamageContext Context;
 	FSekiroAttackContext Atk;
 	Atk.DmgLevel = 3.0f;
 	Atk.GuardLevel = 3.0f;
 	Atk.CurrentHP = 100.0f;
-	UDamagePipelineResults::WriteEffect<FSekiroAttackContext>(Context, Atk);
+	UDamagePipelineResults::WriteEffect<FSekiroAttackContext>(&Context, Atk);
 
-	TArray<FRuleExecutionEntry> Log = Pipeline->Execute(Context);
-	PrintScenarioResult(TEXT("2. Guard (non-JustGuard)"), Context, Log);
+	FDamageExecutionResult Result;
+	Pipeline->ExecuteNative(&Context, Result);
+	PrintScenarioResult(TEXT("2. Guard (non-JustGuard)"), &Context, Pipeline->MakeExecutionLog(Result));
 }
 
 void ADamagePipelineTestActor::RunScenario_JustGuard()
 {
 	Pipeline->ScenarioLabel = TEXT("3.JustGuard");
-	UDamageContext* Context = NewObject<UDamageContext>(this);
+	// 逐次命中的上下文放在栈上：无 UObject 分配
+	FDamageContext Context;
 	FSekiroAttackContext Atk;
 	Atk.DmgLevel = 3.0f;
 	Atk.GuardLevel = 5.0f;
 	Atk.CurrentHP = 100.0f;
 	Atk.bIsPlayer = true;
-	UDamagePipelineResults::WriteEffect<FSekiroAttackContext>(Context, Atk);
+	UDamagePipelineResults::WriteEffect<FSekiroAttackContext>(&Context, Atk);
 
-	TArray<FRuleExecutionEntry> Log = Pipeline->Execute(Context);
-	PrintScenarioResult(TEXT("3. JustGuard (Deflect)"), Context, Log);
+	FDamageExecutionResult Result;
+	Pipeline->ExecuteNative(&Context, Result);
+	PrintScenarioResult(TEXT("3. JustGuard (Deflect)"), &Context, Pipeline->MakeExecutionLog(Result));
 }
 
 // ============================================================================
@@ -214,7 +220,7 @@ void ADamagePipelineTestActor::PrintToScreen(const FString& Message, FColor Colo
 }
 
 void ADamagePipelineTestActor::PrintScenarioResult(
-	const FString& ScenarioName, UDamageContext* Context,
+	const FString& ScenarioName, const FDamageContext* Context,
 	const TArray<FRuleExecutionEntry>& Log) const
 {
 	PrintToScreen(TEXT(""), FColor::White);
@@ -228,9 +234,9 @@ void ADamagePipelineTestActor::PrintScenarioResult(
 	}
 
 	PrintToScreen(TEXT("  Context DamageEffects:"), FColor::Yellow);
-	for (const auto& Pair : UDamagePipelineResults::GetAllEffects(Context))
+	for (const FConstStructView& Effect : UDamagePipelineResults::GetAllEffects(Context))
 	{
-		FString TypeName = Pair.Key ? Pair.Key->GetName() : TEXT("null");
+		FString TypeName = Effect.GetScriptStruct() ? Effect.GetScriptStruct()->GetName() : TEXT("null");
 		PrintToScreen(FString::Printf(TEXT("    [%s]"), *TypeName), FColor::Green);
 	}
 }
@@ -0,0 +1,605 @@
+/***************************************************************************************************************
+* Plugin:       SagaStats
+* Author:       Jinming Zhang
+* Description:  SagaStats offers modular damage process and meter systems to support adaptable status management
+****************************************************************************************************************/
+
+// DamagePipelineSekiroTests.cpp — 只狼 3 场景在各执行路径上的一致性（自动化测试）
+//
+// 基准：在新建的栈上 FDamageContext 上 ExecuteNative。其余路径（批量 / 并行批量 / 推演 / 多目标、
+// 烘焙计划、增量 AddRule / RemoveRule）的执行 Rule 集合与 Context 中全部 Effect 必须与基准逐字段一致。
+#include "DamagePipeline/DamagePipeline.h"
+#include "DamagePipeline/DamagePipelinePlanCache.h"
+#include "DamagePipeline/CompiledDamagePipeline.h"
+#include "DamagePipeline/DamageContext.h"
+#include "DamagePipeline/DamagePredicate.h"
+#include "DamagePipeline/DamagePipelineResults.h"
+
+#include "DamagePipeline/Sekiro/SekiroAttackContext.h"
+#include "DamagePipeline/Sekiro/DR_Mixup.h"
+#include "DamagePipeline/Sekiro/DR_Guard.h"
+#include "DamagePipeline/Sekiro/DR_Hurt.h"
+#include "DamagePipeline/Sekiro/DR_Collapse.h"
+#include "DamagePipeline/Sekiro/DR_CollapseJustGuard.h"
+#include "Tests/DamagePipelineTestTypes.h"
+
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SekiroDamageTest
+{
+	constexpr EAutomationTestFlags TestFlags = EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter;
+
+	// ========================================================================
+	// Pipeline 装配（与 ADamagePipelineTestActor::BuildSekiroPipeline 相同的 5 个 Rule）
+	// ========================================================================
+
+	UDamagePredicate_And* MakeAnd(UObject* Outer, const TArray<UDamagePredicate*>& Children, bool bReverse = false)
+	{
+		UDamagePredicate_And* Node = NewObject<UDamagePredicate_And>(Outer);
+		for (UDamagePredicate* Child : Children) Node->Predicates.Add(Child);
+		Node->bReverse = bReverse;
+		return Node;
+	}
+
+	template<typename TCondClass>
+	UDamagePredicate_Single* MakeCondition(UObject* Outer)
+	{
+		UDamagePredicate_Single* Single = NewObject<UDamagePredicate_Single>(Outer);
+		Single->Condition = NewObject<TCondClass>(Outer);
+		return Single;
+	}
+
+	UDamageRule* MakeRule(UObject* Outer, FName Name, TSubclassOf<UDamageOperationBase> OpClass)
+	{
+		UDamageRule* Rule = NewObject<UDamageRule>(Outer, Name);
+		Rule->OperationClass = OpClass;
+		return Rule;
+	}
+
+	struct FSekiroRules
+	{
+		UDamageRule* Mixup = nullptr;
+		UDamageRule* Guard = nullptr;
+		UDamageRule* Hurt = nullptr;
+		UDamageRule* Collapse = nullptr;
+		UDamageRule* CollapseJustGuard = nullptr;
+
+		TArray<UDamageRule*> All() const { return { Mixup, Guard, Hurt, Collapse, CollapseJustGuard }; }
+
+		/** 每个测试一组新的 Rule（独立 Outer，Rule 名不冲突） */
+		static FSekiroRules Make()
+		{
+			UPackage* Outer = NewObject<UPackage>(nullptr,
+				MakeUniqueObjectName(nullptr, UPackage::StaticClass(), TEXT("/Temp/SekiroDamageTest")), RF_Transient);
+
+			FSekiroRules Rules;
+			Rules.Mixup             = MakeRule(Outer, "Mixup",             UDamageOperation_Mixup::StaticClass());
+			Rules.Guard             = MakeRule(Outer, "Guard",             UDamageOperation_Guard::StaticClass());
+			Rules.Hurt              = MakeRule(Outer, "Hurt",              UDamageOperation_Hurt::StaticClass());
+			Rules.Collapse          = MakeRule(Outer, "Collapse",          UDamageOperation_Collapse::StaticClass());
+			Rules.CollapseJustGuard = MakeRule(Outer, "CollapseJustGuard", UDamageOperation_CollapseJustGuard::StaticClass());
+
+			Rules.Guard->Condition = MakeCondition<UDamageCondition_IsGuard>(Outer);
+
+			// Hurt / Collapse: NOT(IsGuard AND GuardSuccess)——两份结构相同的子树（共享子谓词）
+			for (UDamageRule* Rule : { Rules.Hurt, Rules.Collapse })
+			{
+				Rule->Condition = MakeAnd(Outer, {
+					MakeCondition<UDamageCondition_IsGuard>(Outer),
+					MakeCondition<UDamageCondition_GuardSuccess>(Outer)
+				}, /*bReverse=*/true);
+			}
+
+			Rules.CollapseJustGuard->Condition = MakeAnd(Outer, {
+				MakeCondition<UDamageCondition_GuardSuccess>(Outer),
+				MakeCondition<UDamageCondition_GuardIsJustGuard>(Outer)
+			});
+			return Rules;
+		}
+	};
+
+	UDamagePipeline* MakePipeline(TConstArrayView<UDamageRule*> Rules, bool bBuild = true)
+	{
+		UDamagePipeline* Pipeline = NewObject<UDamagePipeline>(GetTransientPackage());
+		for (UDamageRule* Rule : Rules)
+		{
+			Pipeline->DamageRules.Add(Rule);
+		}
+		if (bBuild)
+		{
+			Pipeline->Build();
+		}
+		return Pipeline;
+	}
+
+	// ========================================================================
+	// 场景（与 ADamagePipelineTestActor 的 3 个场景一致）
+	// ========================================================================
+
+	struct FScenario
+	{
+		const TCHAR* Name;
+		FSekiroAttackContext Attack;
+	};
+
+	TArray<FScenario> MakeScenarios()
+	{
+		TArray<FScenario> Scenarios;
+
+		FScenario& NormalHit = Scenarios.Add_GetRef({ TEXT("NormalHit"), {} });
+		NormalHit.Attack.DmgLevel = 3.f;
+		NormalHit.Attack.CurrentHP = 100.f;
+
+		FScenario& Guard = Scenarios.Add_GetRef({ TEXT("Guard"), {} });
+		Guard.Attack.DmgLevel = 3.f;
+		Guard.Attack.GuardLevel = 3.f;
+		Guard.Attack.CurrentHP = 100.f;
+
+		FScenario& JustGuard = Scenarios.Add_GetRef({ TEXT("JustGuard"), {} });
+		JustGuard.Attack.DmgLevel = 3.f;
+		JustGuard.Attack.GuardLevel = 5.f;
+		JustGuard.Attack.CurrentHP = 100.f;
+		JustGuard.Attack.bIsPlayer = true;
+
+		return Scenarios;
+	}
+
+	// ========================================================================
+	// 结果快照与比较
+	// ========================================================================
+
+	/** 一次执行的可比较结果：执行了的 Rule 名（与计划顺序无关）+ Context 中全部 Effect 的拷贝 */
+	struct FOutcome
+	{
+		TArray<FName> ExecutedRules;
+		TArray<FInstancedStruct> Effects;
+	};
+
+	FOutcome Capture(const TArray<FRuleExecutionEntry>& Log, const FDamageContext& Context)
+	{
+		FOutcome Outcome;
+		for (const FRuleExecutionEntry& Entry : Log)
+		{
+			if (Entry.bExecuted)
+			{
+				Outcome.ExecutedRules.Add(Entry.RuleName);
+			}
+		}
+		Outcome.ExecutedRules.Sort([](FName A, FName B) { return A.LexicalLess(B); });
+
+		for (const FConstStructView& View : UDamagePipelineResults::GetAllEffects(&Context))
+		{
+			Outcome.Effects.Emplace_GetRef().InitializeAs(View.GetScriptStruct(), View.GetMemory());
+		}
+		Outcome.Effects.Sort([](const FInstancedStruct& A, const FInstancedStruct& B)
+		{
+			return A.GetScriptStruct()->GetFName().LexicalLess(B.GetScriptStruct()->GetFName());
+		});
+		return Outcome;
+	}
+
+	FOutcome Capture(const UDamagePipeline* Pipeline, const FDamageExecutionResult& Result, const FDamageContext& Context)
+	{
+		return Capture(Pipeline->MakeExecutionLog(Result), Context);
+	}
+
+	void TestSameOutcome(FAutomationTestBase& Test, const FString& What, const FOutcome& Expected, const FOutcome& Actual)
+	{
+		Test.TestEqual(*(What + TEXT(": executed rules")), Actual.ExecutedRules, Expected.ExecutedRules);
+
+		if (!Test.TestEqual(*(What + TEXT(": effect count")), Actual.Effects.Num(), Expected.Effects.Num()))
+		{
+			return;
+		}
+		for (int32 Index = 0; Index < Expected.Effects.Num(); ++Index)
+		{
+			const FInstancedStruct& A = Expected.Effects[Index];
+			const FInstancedStruct& B = Actual.Effects[Index];
+			const FString TypeName = A.GetScriptStruct()->GetName();
+			if (Test.TestTrue(*(What + TEXT(": effect type ") + TypeName), A.GetScriptStruct() == B.GetScriptStruct()))
+			{
+				Test.TestTrue(*(What + TEXT(": effect value ") + TypeName),
+					A.GetScriptStruct()->CompareScriptStruct(A.GetMemory(), B.GetMemory(), PPF_None));
+			}
+		}
+	}
+
+	/** 基准：新的栈上 Context + ExecuteNative；Prefill 非空时作为预填输入一并写入 */
+	FOutcome RunReference(UDamagePipeline* Pipeline, const FSekiroAttackContext& Attack,
+		const FDamageTestGiveUpEffect* Prefill = nullptr)
+	{
+		FDamageContext Context;
+		UDamagePipelineResults::WriteEffect<FSekiroAttackContext>(&Context, Attack);
+		if (Prefill)
+		{
+			UDamagePipelineResults::WriteEffect<FDamageTestGiveUpEffect>(&Context, *Prefill);
+		}
+
+		FDamageExecutionResult Result;
+		Pipeline->ExecuteNative(&Context, Result);
+		return Capture(Pipeline, Result, Context);
+	}
+}
+
+using namespace SekiroDamageTest;
+
+// ============================================================================
+// 基准本身：3 个场景的预期 Rule 集合
+// ============================================================================
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDamagePipelineSekiroReferenceTest,
+	"SagaStats.DamagePipeline.Sekiro.Reference", SekiroDamageTest::TestFlags)
+
+bool FDamagePipelineSekiroReferenceTest::RunTest(const FString& Parameters)
+{
+	const FSekiroRules Rules = FSekiroRules::Make();
+	UDamagePipeline* Pipeline = MakePipeline(Rules.All());
+	if (!TestEqual(TEXT("compiled rules"), Pipeline->GetNumCompiledRules(), 5))
+	{
+		return false;
+	}
+
+	const TArray<FName> Expected[] = {
+		{ "Collapse", "Hurt", "Mixup" },                   // NormalHit：未格挡
+		{ "Guard", "Mixup" },                              // Guard：格挡成功、非完美
+		{ "CollapseJustGuard", "Guard", "Mixup" },         // JustGuard：完美格挡
+	};
+
+	const TArray<FScenario> Scenarios = MakeScenarios();
+	for (int32 Index = 0; Index < Scenarios.Num(); ++Index)
+	{
+		const FOutcome Outcome = RunReference(Pipeline, Scenarios[Index].Attack);
+		TestEqual(*(FString(Scenarios[Index].Name) + TEXT(": executed rules")), Outcome.ExecutedRules, Expected[Index]);
+	}
+	return true;
+}
+
+// ============================================================================
+// ExecuteBatch / ExecuteBatchParallel
+// ============================================================================
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDamagePipelineSekiroBatchTest,
+	"SagaStats.DamagePipeline.Sekiro.Batch", SekiroDamageTest::TestFlags)
+
+bool FDamagePipelineSekiroBatchTest::RunTest(const FString& Parameters)
+{
+	const FSekiroRules Rules = FSekiroRules::Make();
+	UDamagePipeline* Pipeline = MakePipeline(Rules.All());
+	const TArray<FScenario> Scenarios = MakeScenarios();
+
+	TArray<FOutcome> Expected;
+	for (const FScenario& Scenario : Scenarios)
+	{
+		Expected.Add(RunReference(Pipeline, Scenario.Attack));
+	}
+
+	// 每个场景重复几次：批内相同输入的 Context 互不影响
+	constexpr int32 NumCopies = 4;
+	for (const bool bParallel : { false, true })
+	{
+		TArray<FDamageContext> Contexts;
+		Contexts.SetNum(Scenarios.Num() * NumCopies);
+		TArray<FDamageContext*> ContextPtrs;
+		for (int32 Index = 0; Index < Contexts.Num(); ++Index)
+		{
+			UDamagePipelineResults::WriteEffect<FSekiroAttackContext>(&Contexts[Index], Scenarios[Index % Scenarios.Num()].Attack);
+			ContextPtrs.Add(&Contexts[Index]);
+		}
+
+		TArray<TArray<FRuleExecutionEntry>> Logs;
+		if (bParallel)
+		{
+			Pipeline->ExecuteBatchParallel(ContextPtrs, &Logs);
+		}
+		else
+		{
+			Pipeline->ExecuteBatch(ContextPtrs, &Logs);
+		}
+
+		if (!TestEqual(TEXT("log count"), Logs.Num(), Contexts.Num()))
+		{
+			return false;
+		}
+		for (int32 Index = 0; Index < Contexts.Num(); ++Index)
+		{
+			const int32 ScenarioIndex = Index % Scenarios.Num();
+			TestSameOutcome(*this,
+				FString::Printf(TEXT("%s[%d] %s"), bParallel ? TEXT("ExecuteBatchParallel") : TEXT("ExecuteBatch"), Index, Scenarios[ScenarioIndex].Name),
+				Expected[ScenarioIndex], Capture(Logs[Index], Contexts[Index]));
+		}
+	}
+	return true;
+}
+
+// ============================================================================
+// ExecuteSpeculative：以任一场景为父 Context，分叉改写攻击上下文推演其余场景
+// ============================================================================
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDamagePipelineSekiroSpeculativeTest,
+	"SagaStats.DamagePipeline.Sekiro.Speculative", SekiroDamageTest::TestFlags)
+
+bool FDamagePipelineSekiroSpeculativeTest::RunTest(const FString& Parameters)
+{
+	const FSekiroRules Rules = FSekiroRules::Make();
+	UDamagePipeline* Pipeline = MakePipeline(Rules.All());
+	const TArray<FScenario> Scenarios = MakeScenarios();
+
+	TArray<FOutcome> Expected;
+	for (const FScenario& Scenario : Scenarios)
+	{
+		Expected.Add(RunReference(Pipeline, Scenario.Attack));
+	}
+
+	for (const FScenario& ParentScenario : Scenarios)
+	{
+		FDamageContext Parent;
+		UDamagePipelineResults::WriteEffect<FSekiroAttackContext>(&Parent, ParentScenario.Attack);
+		FDamageExecutionResult ParentResult;
+		Pipeline->ExecuteNative(&Parent, ParentResult);
+
+		// 同一个分叉逐个评估候选（Reset 后复用 Arena），与 AI 的用法一致
+		FDamageContext Fork = Parent.Fork();
+		for (int32 Index = 0; Index < Scenarios.Num(); ++Index)
+		{
+			Fork.Reset();
+			UDamagePipelineResults::WriteEffect<FSekiroAttackContext>(&Fork, Scenarios[Index].Attack);
+
+			FDamageExecutionResult Result;
+			TestTrue(TEXT("ExecuteSpeculative"), Pipeline->ExecuteSpeculative(&Fork, ParentResult, Result));
+			TestSameOutcome(*this,
+				FString::Printf(TEXT("ExecuteSpeculative %s -> %s"), ParentScenario.Name, Scenarios[Index].Name),
+				Expected[Index], Capture(Pipeline, Result, Fork));
+		}
+
+		// 父 Context 未被推演修改
+		TestSameOutcome(*this, FString::Printf(TEXT("ExecuteSpeculative parent %s"), ParentScenario.Name),
+			RunReference(Pipeline, ParentScenario.Attack), Capture(Pipeline, ParentResult, Parent));
+	}
+
+	// 放弃产出：GiveUp 只在玩家攻击时产出，否则保留 Slot 原有的值（预填输入）
+	{
+		TArray<UDamageRule*> GiveUpRules = Rules.All();
+		GiveUpRules.Add(MakeRule(Rules.Mixup->GetOuter(), "GiveUp", UDamageOperation_TestGiveUp::StaticClass()));
+		UDamagePipeline* GiveUpPipeline = MakePipeline(GiveUpRules);
+
+		FDamageTestGiveUpEffect Prefill;
+		Prefill.Value = 42.f;
+
+		struct FGiveUpCase
+		{
+			const TCHAR* Name;
+			int32 ParentScenario;
+			bool bParentPrefill;
+
+			/** INDEX_NONE = 分叉不改写攻击上下文 */
+			int32 ForkScenario;
+			bool bForkPrefill;
+		};
+		const FGiveUpCase Cases[] = {
+			// 父 Context 谓词通过但放弃产出：分叉的预写值不能撤销成父 Context 的（不存在的）产出
+			{ TEXT("parent gave up, fork prefill"),           0, false, INDEX_NONE, true },
+			// 父 Context 自身的预填值不是 Rule 产出：重跑的生产者放弃时不能被遮蔽
+			{ TEXT("parent prefill, rerun gives up"),         0, true,  1,          false },
+			// 父 Context 确有产出：分叉的预写值被同样的产出覆盖
+			{ TEXT("parent produced, fork prefill"),          2, false, INDEX_NONE, true },
+			// 父 Context 确有产出、重跑放弃：完整执行看不到父 Context 的产出
+			{ TEXT("parent produced, rerun gives up"),        2, false, 0,          false },
+		};
+
+		for (const FGiveUpCase& Case : Cases)
+		{
+			const FSekiroAttackContext& ParentAttack = Scenarios[Case.ParentScenario].Attack;
+			FDamageContext Parent;
+			UDamagePipelineResults::WriteEffect<FSekiroAttackContext>(&Parent, ParentAttack);
+			if (Case.bParentPrefill)
+			{
+				UDamagePipelineResults::WriteEffect<FDamageTestGiveUpEffect>(&Parent, Prefill);
+			}
+			FDamageExecutionResult ParentResult;
+			GiveUpPipeline->ExecuteNative(&Parent, ParentResult);
+
+			FDamageContext Fork = Parent.Fork();
+			if (Case.ForkScenario != INDEX_NONE)
+			{
+				UDamagePipelineResults::WriteEffect<FSekiroAttackContext>(&Fork, Scenarios[Case.ForkScenario].Attack);
+			}
+			if (Case.bForkPrefill)
+			{
+				UDamagePipelineResults::WriteEffect<FDamageTestGiveUpEffect>(&Fork, Prefill);
+			}
+
+			FDamageExecutionResult Result;
+			TestTrue(TEXT("ExecuteSpeculative"), GiveUpPipeline->ExecuteSpeculative(&Fork, ParentResult, Result));
+
+			// 完整执行的输入：父 Context 的输入 + 分叉写入
+			const FSekiroAttackContext& Attack = Case.ForkScenario != INDEX_NONE ? Scenarios[Case.ForkScenario].Attack : ParentAttack;
+			const bool bPrefill = Case.bParentPrefill || Case.bForkPrefill;
+			TestSameOutcome(*this, FString::Printf(TEXT("ExecuteSpeculative give-up: %s"), Case.Name),
+				RunReference(GiveUpPipeline, Attack, bPrefill ? &Prefill : nullptr), Capture(GiveUpPipeline, Result, Fork));
+		}
+	}
+	return true;
+}
+
+// ============================================================================
+// ExecuteMultiTarget：攻击上下文分别作为目标侧 / 源侧输入
+// ============================================================================
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDamagePipelineSekiroMultiTargetTest,
+	"SagaStats.DamagePipeline.Sekiro.MultiTarget", SekiroDamageTest::TestFlags)
+
+bool FDamagePipelineSekiroMultiTargetTest::RunTest(const FString& Parameters)
+{
+	const FSekiroRules Rules = FSekiroRules::Make();
+	const TArray<FScenario> Scenarios = MakeScenarios();
+
+	// 目标侧：SourceEffects 为空，全部 Rule 属于目标阶段，每个目标一个场景
+	{
+		UDamagePipeline* Pipeline = MakePipeline(Rules.All());
+
+		TArray<TArray<FInstancedStruct>> TargetInputs;
+		for (const FScenario& Scenario : Scenarios)
+		{
+			TargetInputs.Add({ FInstancedStruct::Make(Scenario.Attack) });
+		}
+
+		FDamageContext Source;
+		TArray<FDamageContext> Targets;
+		TArray<FDamageExecutionResult> Results;
+		TestTrue(TEXT("ExecuteMultiTarget (target-side input)"),
+			Pipeline->ExecuteMultiTarget({}, TargetInputs, Source, Targets, &Results));
+		if (!TestEqual(TEXT("target count"), Targets.Num(), Scenarios.Num()) || !TestEqual(TEXT("result count"), Results.Num(), Scenarios.Num()))
+		{
+			return false;
+		}
+
+		for (int32 Index = 0; Index < Scenarios.Num(); ++Index)
+		{
+			TestSameOutcome(*this, FString::Printf(TEXT("ExecuteMultiTarget target-side %s"), Scenarios[Index].Name),
+				RunReference(Pipeline, Scenarios[Index].Attack), Capture(Pipeline, Results[Index], Targets[Index]));
+		}
+	}
+
+	// 源侧：攻击上下文声明为源侧输入，全部 Rule 属于源阶段，各目标共享源阶段结果
+	for (const FScenario& Scenario : Scenarios)
+	{
+		UDamagePipeline* Pipeline = MakePipeline(Rules.All(), /*bBuild=*/false);
+		Pipeline->SourceEffects.Add(FSekiroAttackContext::StaticStruct());
+		Pipeline->Build();
+
+		constexpr int32 NumTargets = 3;
+		TArray<TArray<FInstancedStruct>> TargetInputs;
+		TargetInputs.SetNum(NumTargets);
+
+		FDamageContext Source;
+		TArray<FDamageContext> Targets;
+		TArray<FDamageExecutionResult> Results;
+		TestTrue(TEXT("ExecuteMultiTarget (source-side input)"),
+			Pipeline->ExecuteMultiTarget({ FInstancedStruct::Make(Scenario.Attack) }, TargetInputs, Source, Targets, &Results));
+		if (!TestEqual(TEXT("result count"), Results.Num(), NumTargets))
+		{
+			return false;
+		}
+
+		const FOutcome Expected = RunReference(Pipeline, Scenario.Attack);
+		for (int32 Index = 0; Index < NumTargets; ++Index)
+		{
+			TestSameOutcome(*this, FString::Printf(TEXT("ExecuteMultiTarget source-side %s[%d]"), Scenario.Name, Index),
+				Expected, Capture(Pipeline, Results[Index], Targets[Index]));
+		}
+	}
+	return true;
+}
+
+// ============================================================================
+// 烘焙计划：Export → Import 后的计划与新编译的计划结果一致
+// ============================================================================
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDamagePipelineSekiroCookedTest,
+	"SagaStats.DamagePipeline.Sekiro.CookedPlan", SekiroDamageTest::TestFlags)
+
+bool FDamagePipelineSekiroCookedTest::RunTest(const FString& Parameters)
+{
+	const FSekiroRules Rules = FSekiroRules::Make();
+	FDamagePipelinePlanCache& Cache = FDamagePipelinePlanCache::Get();
+
+	UDamagePipeline* Uncooked = MakePipeline(Rules.All());
+	const FDamagePlanKey Key = FDamagePlanKey::Make(Uncooked->DamageRules, Uncooked->ObservedEffects);
+	const TSharedPtr<FCompiledDamagePipeline> Compiled = Cache.Find(Key);
+	if (!TestTrue(TEXT("compiled plan is cached"), Compiled.IsValid()))
+	{
+		return false;
+	}
+
+	// 与 Cook（PreSave）/ 加载（RestoreCookedPlan）相同的导出 / 导入
+	FDamageCookedPlan Cooked;
+	Compiled->ExportCooked(Cooked);
+	TSharedRef<FCompiledDamagePipeline> Restored = MakeShared<FCompiledDamagePipeline>();
+	if (!TestTrue(TEXT("ImportCooked"), Restored->ImportCooked(Cooked)))
+	{
+		return false;
+	}
+
+	// 让同键的 Build 采用恢复出的计划
+	Cache.Empty();
+	Cache.Add(Key, Restored);
+	UDamagePipeline* CookedPipeline = MakePipeline(Rules.All());
+	Cache.Empty();
+
+	TestEqual(TEXT("compiled rules"), CookedPipeline->GetNumCompiledRules(), Uncooked->GetNumCompiledRules());
+	for (const FScenario& Scenario : MakeScenarios())
+	{
+		TestSameOutcome(*this, FString::Printf(TEXT("CookedPlan %s"), Scenario.Name),
+			RunReference(Uncooked, Scenario.Attack), RunReference(CookedPipeline, Scenario.Attack));
+	}
+	return true;
+}
+
+// ============================================================================
+// 增量 AddRule / RemoveRule 与完整 Build 结果一致
+// ============================================================================
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDamagePipelineSekiroIncrementalTest,
+	"SagaStats.DamagePipeline.Sekiro.Incremental", SekiroDamageTest::TestFlags)
+
+bool FDamagePipelineSekiroIncrementalTest::RunTest(const FString& Parameters)
+{
+	const FSekiroRules Rules = FSekiroRules::Make();
+	FDamagePipelinePlanCache& Cache = FDamagePipelinePlanCache::Get();
+	const TArray<FScenario> Scenarios = MakeScenarios();
+
+	// 每一步前清空计划缓存：增量路径不能命中完整 Build 留下的同键计划
+	auto CompareWithFullBuild = [this, &Cache, &Scenarios](const TCHAR* What, UDamagePipeline* Patched, TConstArrayView<UDamageRule*> FullRules)
+	{
+		Cache.Empty();
+		UDamagePipeline* Full = MakePipeline(FullRules);
+		TestEqual(*(FString(What) + TEXT(": compiled rules")), Patched->GetNumCompiledRules(), Full->GetNumCompiledRules());
+		for (const FScenario& Scenario : Scenarios)
+		{
+			TestSameOutcome(*this, FString::Printf(TEXT("%s %s"), What, Scenario.Name),
+				RunReference(Full, Scenario.Attack), RunReference(Patched, Scenario.Attack));
+		}
+	};
+
+	// AddRule：在 4 条 Rule 的计划上加入 CollapseJustGuard（无下游，就地追加）
+	{
+		Cache.Empty();
+		UDamagePipeline* Patched = MakePipeline({ Rules.Mixup, Rules.Guard, Rules.Hurt, Rules.Collapse });
+		Cache.Empty();
+		TestTrue(TEXT("AddRule"), Patched->AddRule(Rules.CollapseJustGuard));
+		CompareWithFullBuild(TEXT("AddRule(CollapseJustGuard)"), Patched, Rules.All());
+	}
+
+	// AddRule：加入有下游的 Guard（插在第一个消费者之前）
+	{
+		Cache.Empty();
+		UDamagePipeline* Patched = MakePipeline({ Rules.Mixup, Rules.Hurt, Rules.Collapse, Rules.CollapseJustGuard });
+		Cache.Empty();
+		TestTrue(TEXT("AddRule"), Patched->AddRule(Rules.Guard));
+		CompareWithFullBuild(TEXT("AddRule(Guard)"), Patched,
+			{ Rules.Mixup, Rules.Hurt, Rules.Collapse, Rules.CollapseJustGuard, Rules.Guard });
+	}
+
+	// RemoveRule：删去 Collapse（与 Hurt 共享的子谓词仍被 Hurt 引用）与 Hurt（共享子谓词失去全部引用）
+	{
+		Cache.Empty();
+		UDamagePipeline* Patched = MakePipeline(Rules.All());
+		Cache.Empty();
+		TestTrue(TEXT("RemoveRule"), Patched->RemoveRule(Rules.Collapse));
+		CompareWithFullBuild(TEXT("RemoveRule(Collapse)"), Patched,
+			{ Rules.Mixup, Rules.Guard, Rules.Hurt, Rules.CollapseJustGuard });
+
+		Cache.Empty();
+		TestTrue(TEXT("RemoveRule"), Patched->RemoveRule(Rules.Hurt));
+		CompareWithFullBuild(TEXT("RemoveRule(Collapse, Hurt)"), Patched,
+			{ Rules.Mixup, Rules.Guard, Rules.CollapseJustGuard });
+	}
+
+	Cache.Empty();
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
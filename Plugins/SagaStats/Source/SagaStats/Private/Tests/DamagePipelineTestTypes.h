@@ -0,0 +1,54 @@
+/***************************************************************************************************************
+* Plugin:       SagaStats
+* Author:       Jinming Zhang
+* Description:  SagaStats offers modular damage process and meter systems to support adaptable status management
+****************************************************************************************************************/
+
+// DamagePipelineTestTypes.h — 自动化测试专用的 Effect / Operation
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DamagePipeline/DamageOperationBase.h"
+#include "DamagePipeline/Sekiro/SekiroAttackContext.h"
+#include "DamagePipelineTestTypes.generated.h"
+
+// ============================================================================
+// Effect
+// ============================================================================
+
+USTRUCT()
+struct FDamageTestGiveUpEffect
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	float Value = 0.f;
+};
+
+// ============================================================================
+// Operation：非玩家攻击时放弃产出（Slot 保留原有的值）
+// ============================================================================
+
+UCLASS(HideDropDown, NotBlueprintable)
+class UDamageOperation_TestGiveUp : public UDamageOperationBase
+{
+	GENERATED_BODY()
+public:
+	UDamageOperation_TestGiveUp()
+	{
+		EffectType = FDamageTestGiveUpEffect::StaticStruct();
+		ConsumedEffectTypes.Add(FSekiroAttackContext::StaticStruct());
+		bThreadSafe = true;
+	}
+
+	virtual bool ExecuteInPlace(FDamageContext* Context, FStructView OutEffect) override
+	{
+		const FSekiroAttackContext* Atk = ReadEffect<FSekiroAttackContext>(Context);
+		if (!Atk || !Atk->bIsPlayer)
+		{
+			return false;
+		}
+		OutEffect.Get<FDamageTestGiveUpEffect>().Value = Atk->DmgLevel;
+		return true;
+	}
+};
@@ -0,0 +1,353 @@
+/***************************************************************************************************************
+* Plugin:       SagaStats
+* Author:       Jinming Zhang
+* Description:  SagaStats offers modular damage process and meter systems to support adaptable status management
+****************************************************************************************************************/
+
+// CompiledDamagePipeline.h — FCompiledDamagePipeline: Build() 产出的扁平执行计划
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DamagePipeline/DamageContext.h"
+
+class UDamageRule;
+class UDamagePredicate;
+class UDamageCondition;
+struct FDamageContext;
+class UDamageOperationBase;
+class UScriptStruct;
+struct FDamageCookedPlan;
+
+/**
+ * 谓词字节码操作码。
+ *
+ * 单累加器模型：Const/Condition 写 Acc，Jump 读 Acc 决定是否跳过后续指令。
+ * AND/OR 编译为短路跳转；bReverse（NOT）在编译期按 De Morgan 下推到叶子，
+ * 由叶子指令的 bNegate 承载——运行时不存在 NOT 指令。
+ * 发射前谓词树已规范化（展平、常量折叠、按估计开销排序孩子），见 CompiledDamagePipeline.cpp。
+ */
+enum class EDamagePredicateOp : uint8
+{
+	Const,        // Acc = (Operand != 0)
+	Condition,    // Acc = Conditions[Operand]->EvaluateCondition(Context) XOR bNegate
+	JumpIfFalse,  // if (!Acc) 跳过后续 Operand 条指令
+	JumpIfTrue,   // if (Acc)  跳过后续 Operand 条指令
+	Subexpr,      // Acc = 求值 Subexprs[Operand] XOR bNegate（跨 Rule 共享的子谓词）
+};
+
+/** 一条谓词指令（8 字节；典型 Sekiro 谓词 3~5 条，落在同一 cache line） */
+struct FDamagePredicateInstr
+{
+	EDamagePredicateOp Op = EDamagePredicateOp::Const;
+
+	/** Condition / Subexpr 指令：结果取反（折叠后的 NOT） */
+	bool bNegate = false;
+
+	/** Const：0/1；Condition：Conditions 下标；Subexpr：Subexprs 下标；Jump：向前跳过的指令数 */
+	int32 Operand = 0;
+};
+static_assert(sizeof(FDamagePredicateInstr) == 8, "FDamagePredicateInstr 应保持 8 字节");
+
+/**
+ * 跨 Rule 共享的子谓词（出现两次以上的相同 AND / OR 子树）：字节码只编译一份，
+ * 由各处的 Subexpr 指令引用。Body 不含祖先的 NOT（由引用指令的 bNegate 承载）。
+ */
+struct FDamagePredicateSubexpr
+{
+	int32 Start = 0;
+	int32 Num = 0;
+
+	/** 结构哈希与代表节点（增量编译时查找可复用的子表达式；代表节点随 Rule 移除失效后不再复用） */
+	uint32 Hash = 0;
+	TWeakObjectPtr<const UDamagePredicate> Representative;
+
+	/** Body 的估计开销（引用处参与孩子排序） */
+	float Cost = 0.f;
+};
+
+/**
+ * 单次执行（单个 Context）的谓词记忆：记忆安全（MemoSafe）的共享 Condition / 子谓词每次命中至多求值一次。
+ * 下标：Condition i → i；Subexpr k → Conditions.Num() + k。
+ */
+struct FDamagePredicateMemo
+{
+	TBitArray<> Known;
+	TBitArray<> Value;
+
+	void Reset(int32 NumEntries)
+	{
+		Known.Init(false, NumEntries);
+		Value.Init(false, NumEntries);
+	}
+};
+
+/**
+ * 单条 DamageRule 的编译记录。
+ *
+ * Build() 时一次性解析：Operation 实例（免去 Execute 中的 TMap<UClass*> 查找）、
+ * 产出 EffectType 及其 Slot（免去每次经 CDO 查询 GetProducesEffectType）、谓词字节码区间。
+ * 记录本身不持有 UObject 引用——由持有计划的 UDamagePipeline 与 FDamagePipelinePlanCache
+ * 经 FCompiledDamagePipeline::AddReferencedObjects 报告给 GC。
+ */
+struct FCompiledDamageRule
+{
+	/** 源 Rule（日志 / 调试 / Mermaid 导出用，执行热路径不读） */
+	UDamageRule* Rule = nullptr;
+
+	/** 谓词字节码在 FCompiledDamagePipeline::PredicateCode 中的区间；PredicateNum == 0 = 无 Condition，始终执行 */
+	int32 PredicateStart = 0;
+	int32 PredicateNum = 0;
+
+	/** 已解析的 Operation 逻辑实例；nullptr = 无 OperationClass（只记录执行，不产出） */
+	UDamageOperationBase* Operation = nullptr;
+
+	/** 产出的 Effect 类型（Build 时从 Operation CDO 解析一次） */
+	UScriptStruct* EffectType = nullptr;
+
+	/** EffectType 在 FCompiledDamagePipeline::Layout 中的 Slot */
+	int32 EffectSlot = INDEX_NONE;
+
+	/** 读取的 Slot（谓词 + Operation 声明）在 FCompiledDamagePipeline::ReadSlots 中的区间 */
+	int32 ReadSlotStart = 0;
+	int32 ReadSlotNum = 0;
+};
+
+/**
+ * FDamageRuleGraph — 按 Rule 下标的依赖图（CSR 邻接数组），供稳定拓扑排序使用。
+ *
+ * 构建：逐节点 BeginNode() 后 AddDependency(上游下标)，最后 Finalize() 生成反向邻接。
+ * 全程只有连续数组，无 TMap / TSet；构建与排序均为 O((V+E) log V)。
+ */
+struct SAGASTATS_API FDamageRuleGraph
+{
+	/** 第 i 个节点的上游：Dependencies[DependencyStarts[i], DependencyStarts[i + 1]) */
+	TArray<int32> DependencyStarts;
+	TArray<int32> Dependencies;
+
+	/** 第 i 个节点的下游（Finalize 生成，按下游下标升序）：Dependents[DependentStarts[i], DependentStarts[i + 1]) */
+	TArray<int32> DependentStarts;
+	TArray<int32> Dependents;
+
+	int32 Num() const { return FMath::Max(DependencyStarts.Num() - 1, 0); }
+
+	void Reset(int32 ExpectedNodes = 0, int32 ExpectedEdges = 0);
+
+	/** 开始下一个节点（下标 = 已开始的节点数）；此后 AddDependency 都属于该节点 */
+	void BeginNode() { DependencyStarts.Add(Dependencies.Num()); }
+
+	/** 当前节点依赖 Upstream（调用方负责去重） */
+	void AddDependency(int32 Upstream) { Dependencies.Add(Upstream); }
+
+	/** 封闭最后一个节点并生成反向邻接 */
+	void Finalize();
+
+	TConstArrayView<int32> GetDependencies(int32 Node) const
+	{
+		return MakeArrayView(Dependencies).Slice(DependencyStarts[Node], DependencyStarts[Node + 1] - DependencyStarts[Node]);
+	}
+
+	TConstArrayView<int32> GetDependents(int32 Node) const
+	{
+		return MakeArrayView(Dependents).Slice(DependentStarts[Node], DependentStarts[Node + 1] - DependentStarts[Node]);
+	}
+
+	/**
+	 * 稳定 Kahn 排序：就绪节点中下标最小者优先（二叉堆），无依赖关系的节点保持原始相对顺序。
+	 * @param OutOrder  排出的节点下标；有环时环上及其下游节点缺席
+	 * @return          true = 无环
+	 */
+	bool StableSort(TArray<int32>& OutOrder) const;
+};
+
+/**
+ * 按需执行的子计划：产出一组请求 Effect 所需的最少 Rule。
+ */
+struct FDamageSubPlan
+{
+	/** 请求的 Slot（升序去重，缓存键） */
+	TArray<int32> RequestedSlots;
+
+	/** 需要执行的 Rule 下标（升序 = 拓扑序） */
+	TArray<int32> RuleIndices;
+};
+
+/**
+ * FCompiledDamagePipeline — 按拓扑顺序排列的连续 Rule 记录数组。
+ *
+ * Execute 热路径只顺序遍历 Rules，不做 map 查找、不查 CDO。
+ * Layout 为本 Pipeline 涉及的全部 Effect 类型（产出 + Condition 消费）分配稠密 Slot，
+ * Execute 时绑定到 FDamageContext，Context 按 Slot 存取。
+ *
+ * 计划可经 FDamagePipelinePlanCache 被多个 Pipeline 共享：Finish 之后视为不可变，
+ * 唯一的例外是子计划缓存（派生数据，游戏线程按需填充）。
+ */
+struct SAGASTATS_API FCompiledDamagePipeline
+{
+	/** 按 SortedRules 顺序排列的编译记录 */
+	TArray<FCompiledDamageRule> Rules;
+
+	/** Effect Slot 布局；每次重新编译都换成新对象（已绑定旧布局的 Context 据此检测并迁移） */
+	TSharedRef<FDamageEffectLayout> Layout = MakeShared<FDamageEffectLayout>();
+
+	/** 全部 Rule 的谓词字节码；各 Rule 区间互不重叠（增量加入的 Rule 追加在末尾，不保证按 Rules 顺序） */
+	TArray<FDamagePredicateInstr> PredicateCode;
+
+	/**
+	 * Condition 指令引用的叶子 Condition（按内容去重：类型相同且属性值全部相同的 Condition
+	 * 即使分属不同 Rule 也只保留第一个实例）
+	 */
+	TArray<const UDamageCondition*> Conditions;
+
+	/** 共享子谓词 */
+	TArray<FDamagePredicateSubexpr> Subexprs;
+
+	/**
+	 * 记忆项是否可安全复用（Finish 计算）：项读取的 Slot 在其首次被求值之后不再被任何 Rule 写入，
+	 * 且不含上下文 Condition（其读取的 Game 扩展字段不受 Slot 追踪）。不安全的项每次照常求值。
+	 */
+	TBitArray<> MemoSafe;
+
+	int32 NumMemoEntries() const { return Conditions.Num() + Subexprs.Num(); }
+
+	/** 全部 Rule 的读取 Slot；区间约定同 PredicateCode */
+	TArray<int32> ReadSlots;
+
+	/** 计划自有的 Operation 实例（每个 OperationClass 一个，Outer 为临时包，不随某个 Pipeline 销毁） */
+	TArray<UDamageOperationBase*> Operations;
+
+	/** 已编译（Build 成功后为 true；Rules 可能为空） */
+	bool bCompiled = false;
+
+	/** 全部 Operation 与 Condition 均声明线程安全（可走 ExecuteBatchParallel / bParallelLevels） */
+	bool bThreadSafe = false;
+
+	/**
+	 * 拓扑分层：同层 Rule 之间没有 Slot 读写冲突（RAW / WAR / WAW），可对同一 Context 并发执行，
+	 * 且结果与按 Rules 顺序串行执行一致。
+	 * LevelRules 按层连续存放 Rule 下标（层内保持 Rules 顺序）；第 L 层为 [LevelStarts[L], LevelStarts[L + 1])。
+	 */
+	TArray<int32> LevelRules;
+	TArray<int32> LevelStarts;
+
+	/** 最宽一层的 Rule 数 */
+	int32 MaxLevelWidth = 0;
+
+	int32 NumLevels() const { return FMath::Max(LevelStarts.Num() - 1, 0); }
+
+	/** 查找 EffectType 的 Slot；不存在则分配新 Slot（布局已封闭时类型须已由 ExtendLayout 加入） */
+	int32 FindOrAddEffectSlot(UScriptStruct* EffectType);
+
+	/** 查找 EffectType 的 Slot；不存在返回 INDEX_NONE */
+	int32 FindEffectSlot(const UScriptStruct* EffectType) const;
+
+	/** 查找或创建 OperationClass 的实例 */
+	UDamageOperationBase* FindOrCreateOperation(UClass* OperationClass);
+
+	/** 编译单条 Rule（谓词、Operation、产出 / 消费 Slot）；布局须尚未封闭或已包含 Rule 涉及的全部类型 */
+	void CompileRule(UDamageRule* Rule, FCompiledDamageRule& Compiled);
+
+	/** Rules 变更后的收尾：封闭布局、解析蓝图分发、线程安全、分层，作废子计划 */
+	void Finish();
+
+	/** 向 GC 报告计划引用的 Rule 与 Operation */
+	void AddReferencedObjects(FReferenceCollector& Collector);
+
+	/**
+	 * 公共子表达式提取（CompilePlan 在编译各 Rule 之前调用）：在全部 Roots 中出现两次以上的相同
+	 * AND / OR 子树各编译一份共享字节码，之后 CompilePredicate 遇到相同子树时改为发射 Subexpr 指令。
+	 */
+	void ShareCommonPredicates(TConstArrayView<const UDamagePredicate*> Roots);
+
+	/**
+	 * 对象内容哈希：类 + 全部属性值（不支持直接哈希的属性按导出文本哈希）。
+	 * bStable = true 时类按路径名、属性一律按导出文本哈希，跨进程稳定（烘焙计划校验用，较慢）
+	 */
+	static uint32 HashObjectContent(const UObject* Object, bool bStable = false);
+
+	/** 谓词树结构哈希：节点类型、bReverse、叶子 Condition 内容（结构相同的树哈希相同） */
+	static uint32 HashPredicateContent(const UDamagePredicate* Node, bool bStable = false);
+
+	/**
+	 * Operation 类的产销声明哈希：类 + CDO 的 GetEffectType / GetConsumedEffectTypes。
+	 * 蓝图 Operation 在 Class Defaults 中改产销类型时类指针不变，须靠此哈希让缓存键随之变化
+	 */
+	static uint32 HashOperationDeclaration(const UClass* OperationClass, bool bStable = false);
+
+	/** 导出为可序列化的烘焙计划（ContentHash 由调用方填写） */
+	void ExportCooked(FDamageCookedPlan& Out) const;
+
+	/** 从烘焙计划恢复并 Finish；数据不完整（引用的类型 / 对象已不存在）时返回 false */
+	bool ImportCooked(const FDamageCookedPlan& In);
+
+	/** 把 Root 谓词树编译为字节码，追加到 PredicateCode，写入 Into 的区间 */
+	void CompilePredicate(const UDamagePredicate* Root, FCompiledDamageRule& Into);
+
+	TConstArrayView<int32> GetReadSlots(const FCompiledDamageRule& Rule) const
+	{
+		return MakeArrayView(ReadSlots).Slice(Rule.ReadSlotStart, Rule.ReadSlotNum);
+	}
+
+	/** 按 Slot 读写集合计算拓扑分层（Rules / ReadSlots 填好后调用） */
+	void BuildLevels();
+
+	/**
+	 * 生成产出 RequestedSlots 的子计划（从请求 Slot 沿产销关系反向遍历）。
+	 * @param RequestedSlots  升序去重
+	 * 不修改计划（计划可能被多个 Pipeline / 工作线程共享）；缓存由调用方（UDamagePipeline）持有。
+	 */
+	void BuildSubPlan(TConstArrayView<int32> RequestedSlots, FDamageSubPlan& OutSubPlan) const;
+
+	/**
+	 * 增量修改：布局缺少 Types 中的某些类型时，换成追加了这些 Slot 的新布局（已有 Slot 下标不变）。
+	 * 已绑定旧布局的 Context 下次绑定时迁移。
+	 */
+	void ExtendLayout(TConstArrayView<UScriptStruct*> Types);
+
+	/** 增量修改：删除一条编译记录，压紧其字节码 / 读取 Slot，并删去不再被引用的共享子谓词与 Condition */
+	void RemoveRuleAt(int32 RuleIndex);
+
+	/**
+	 * 解释执行 Rule 的谓词字节码。
+	 * @param Memo  本次执行的记忆（须已 Reset(NumMemoEntries())）；nullptr = 不记忆（并发评估同一 Context 时）
+	 */
+	bool EvaluatePredicate(const FCompiledDamageRule& Rule, const FDamageContext* Context, FDamagePredicateMemo* Memo = nullptr) const;
+
+	void Reset();
+
+private:
+	/** 规范化后的谓词项（定义见 .cpp） */
+	struct FPredicateTerm;
+
+	/**
+	 * 把谓词树降为规范化的谓词项；bNegate 为祖先累积的 NOT（De Morgan 下推）。
+	 * bAllowShared = false 时本节点不替换为 Subexpr 引用（编译子表达式自身的 Body 时）
+	 */
+	FPredicateTerm LowerPredicate(const UDamagePredicate* Node, bool bNegate, bool bAllowShared);
+
+	/** AND / OR 项的展平、常量折叠、去重与开销排序 */
+	static void SimplifyTerm(FPredicateTerm& Term);
+
+	/** 把谓词项发射为字节码，追加到 PredicateCode */
+	void EmitTerm(const FPredicateTerm& Term);
+
+	/** 解释执行 PredicateCode 中的一段 */
+	bool EvaluateCode(int32 Start, int32 Num, const FDamageContext* Context, FDamagePredicateMemo* Memo) const;
+
+	/** 按内容去重地登记 Condition，返回下标 */
+	int32 FindOrAddCondition(const UDamageCondition* Condition);
+
+	/** 查找与 Node 结构相同的共享子谓词 */
+	int32 FindSubexpr(const UDamagePredicate* Node) const;
+
+	/** 计算 MemoSafe */
+	void ComputeMemoSafety();
+
+	/** 与 Conditions 平行：内容哈希 */
+	TArray<uint32> ConditionHashes;
+
+	/** 内容哈希 → Conditions 下标（FindOrAddCondition 去重查找；哈希碰撞的多个条目都登记） */
+	TMultiMap<uint32, int32> ConditionIndexByHash;
+
+	/** 跳转穿透：目标若为同向跳转则继续穿透，若为反向跳转则落到其下一条 */
+	void ThreadJumps(int32 Start, int32 Num);
+};
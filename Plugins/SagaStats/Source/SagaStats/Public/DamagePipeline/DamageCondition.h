@@ -10,6 +10,7 @@
 #include "CoreMinimal.h"
 #include "DamageCondition.generated.h"
 
+struct FDamageContext;
 class UDamageContext;
 
 // ============================================================================
@@ -50,7 +51,11 @@ public:
 	 *   _Effect 版：按 EffectType 从 DC 预取 InEffect → 调 Evaluate(Context, InEffect)
 	 *   _Context 版：直接调 Evaluate(Context)
 	 */
-	virtual bool EvaluateCondition(const UDamageContext* Context) const PURE_VIRTUAL(UDamageCondition::EvaluateCondition, return false;);
+	virtual bool EvaluateCondition(const FDamageContext* Context) const PURE_VIRTUAL(UDamageCondition::EvaluateCondition, return false;);
+
+	/** 以 UDamageContext 评估 */
+	bool EvaluateCondition(const UDamageContext* Context) const;
+	bool EvaluateCondition(std::nullptr_t) const { return EvaluateCondition(static_cast<const FDamageContext*>(nullptr)); }
 
 	/**
 	 * 返回本 Condition 所依赖的 EffectType（R5 产销依赖声明）。
@@ -59,6 +64,28 @@ public:
 	 */
 	virtual UScriptStruct* GetEffectType() const { return nullptr; }
 
+	/**
+	 * 是否可在工作线程上评估（UDamagePipeline::ExecuteBatchParallel）。
+	 * 只有原生类的声明生效——蓝图子类走 BP VM，一律视为非线程安全。
+	 */
+	bool IsThreadSafe() const { return bThreadSafe && GetClass()->HasAnyClassFlags(CLASS_Native); }
+
+	/**
+	 * Build 时由 UDamagePipeline 调用：检测本类的 Evaluate 事件是否被蓝图 override。
+	 * 没有 override 时之后直接调用 Evaluate_Implementation，跳过 BlueprintNativeEvent thunk
+	 * （FindFunction + ProcessEvent）。未解析前一律走事件。
+	 */
+	virtual void ResolveNativeDispatch() const {}
+
+	/** Evaluate 是否仍经蓝图事件分发（ResolveNativeDispatch 之后有意义） */
+	bool UsesScriptDispatch() const { return bScriptEvaluate; }
+
+	/**
+	 * 单次评估的估计开销（相对值）。Build 时 AND / OR 的孩子按此升序求值，廉价的判定先短路。
+	 * 默认：原生实现 1，经蓝图事件分发 10。查询场景、遍历容器等重判定的 C++ 子类可 override 返回更大的值。
+	 */
+	virtual float GetEvaluationCost() const { return bScriptEvaluate ? 10.f : 1.f; }
+
 	/** 显示字符串（Graph 节点 / Tooltip 用；蓝图可 override） */
 	UFUNCTION(BlueprintNativeEvent, BlueprintPure, Category = "DamageCondition")
 	FString GetDisplayString() const;
@@ -69,4 +96,14 @@ public:
 		Name.RemoveFromEnd(TEXT("_C"));
 		return Name;
 	}
+
+protected:
+	/**
+	 * C++ 子类在构造函数中置 true，声明 EvaluateCondition 只读 Context / 自身配置、无共享可变状态。
+	 * 同一 Condition 实例会被多个工作线程并发评估（各自不同的 Context）。
+	 */
+	bool bThreadSafe = false;
+
+	/** Evaluate 事件有蓝图 override（由 ResolveNativeDispatch 写入；默认 true = 走事件） */
+	mutable bool bScriptEvaluate = true;
 };
@@ -12,6 +12,7 @@
 #include "DamageCondition_Context.generated.h"
 
 class UDamageContext;
+struct FDamageContext;
 
 // ============================================================================
 // UDamageCondition_Context — 基于 Context 的条件原子
@@ -51,16 +52,21 @@ class SAGASTATS_API UDamageCondition_Context : public UDamageCondition
 	GENERATED_BODY()
 
 public:
-	/** 公共入口：直接 dispatch 到 Evaluate（不预取任何 Effect） */
-	virtual bool EvaluateCondition(const UDamageContext* Context) const override final;
+	/** 公共入口：直接 dispatch 到 Evaluate（不预取任何 Effect），传入 Context 的 UDamageContext 包装 */
+	virtual bool EvaluateCondition(const FDamageContext* Context) const override final;
+	using UDamageCondition::EvaluateCondition;
 
 	/**
 	 * 子类重写——BlueprintNativeEvent。
-	 * @param Context 共享上下文（访问受限：只能读 Game 扩展字段，不能读 Effect）
+	 * @param Context 共享上下文（访问受限：只能读 Game 扩展字段，不能读 Effect）；
+	 *                以栈上 / 池中的 FDamageContext 执行时蓝图拿到池化的代理（见 FDamageScriptContext，没有 Game 扩展字段可读），
+	 *                原生实现拿到 nullptr
 	 */
 	UFUNCTION(BlueprintNativeEvent, Category = "DamageCondition")
 	bool Evaluate(const UDamageContext* Context) const;
 	virtual bool Evaluate_Implementation(const UDamageContext* Context) const { return false; }
 
+	virtual void ResolveNativeDispatch() const override;
+
 	// 不 override GetEffectType —— 基类默认 nullptr → 不贡献拓扑依赖
 };
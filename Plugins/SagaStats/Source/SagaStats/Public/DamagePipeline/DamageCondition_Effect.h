@@ -9,10 +9,12 @@
 
 #include "CoreMinimal.h"
 #include "StructUtils/InstancedStruct.h"
+#include "StructUtils/StructView.h"
 #include "DamagePipeline/DamageCondition.h"
 #include "DamageCondition_Effect.generated.h"
 
 class UDamageContext;
+struct FDamageContext;
 
 // ============================================================================
 // UDamageCondition_Effect — 基于 Effect 的条件原子
@@ -20,14 +22,21 @@ class UDamageContext;
 
 /**
  * 基于 Effect 的条件原子。子类绑定一个 EffectType（声明 R5 产销依赖），
- * 框架在 Evaluate 前自动按 EffectType 从 DC 预取对应 Effect 传入。
+ * 框架在评估前自动按 EffectType 从 DC 预取对应 Effect 传入。
+ *
+ * 预取以 FConstStructView 形式直接指向 DC 存储（不拷贝）。C++ 子类 override EvaluateView；
+ * 蓝图子类 override Evaluate 事件，由基类 EvaluateView 默认实现桥接（仅蓝图路径拷贝一次）。
  *
  * 子类写法（C++ 推荐，构造函数赋 EffectType 字段）：
  *   UCLASS()
  *   class UDamageCondition_IsLightning : public UDamageCondition_Effect
  *   {
  *       UDamageCondition_IsLightning() { EffectType = FSekiroAttackContext::StaticStruct(); }
- *       virtual bool Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& InEffect) const override;
+ *       virtual bool EvaluateView(const FDamageContext* Context, FConstStructView InEffect) const override
+ *       {
+ *           const FSekiroAttackContext* Atk = InEffect.GetPtr<const FSekiroAttackContext>();
+ *           return Atk && Atk->bIsLightning;
+ *       }
  *   };
  *
  * 子类写法（蓝图）：
@@ -46,18 +55,35 @@ class SAGASTATS_API UDamageCondition_Effect : public UDamageCondition
 	GENERATED_BODY()
 
 public:
-	/** 公共入口：按 EffectType 预取 Effect 后调 Evaluate */
-	virtual bool EvaluateCondition(const UDamageContext* Context) const override final;
+	/** 公共入口：按 EffectType 预取 Effect 视图后调 EvaluateView */
+	virtual bool EvaluateCondition(const FDamageContext* Context) const override final;
+	using UDamageCondition::EvaluateCondition;
 
 	/**
-	 * 子类重写——BlueprintNativeEvent。
+	 * C++ 子类重写。
 	 * @param Context   共享上下文（访问受限：不能读其他 Effect）
+	 * @param InEffect  指向 DC 中该 EffectType 存储的只读视图（缺失时为无效视图）；仅在本次调用内有效
+	 *
+	 * 默认实现把视图拷贝为 FInstancedStruct 后调蓝图 Evaluate 事件。
+	 */
+	virtual bool EvaluateView(const FDamageContext* Context, FConstStructView InEffect) const;
+
+	/** 以 UDamageContext 评估视图 */
+	bool EvaluateView(const UDamageContext* Context, FConstStructView InEffect) const;
+	bool EvaluateView(std::nullptr_t, FConstStructView InEffect) const { return EvaluateView(static_cast<const FDamageContext*>(nullptr), InEffect); }
+
+	/**
+	 * 蓝图子类重写——BlueprintNativeEvent。
+	 * @param Context   共享上下文的 UDamageContext 包装（访问受限：不能读其他 Effect）；
+	 *                  裸 FDamageContext 执行时为池化的代理（见 FDamageScriptContext）
 	 * @param InEffect  框架按 EffectType 从 DC 预取的 Effect（缺失时为 invalid FInstancedStruct）
 	 */
 	UFUNCTION(BlueprintNativeEvent, Category = "DamageCondition")
 	bool Evaluate(const UDamageContext* Context, const FInstancedStruct& InEffect) const;
 	virtual bool Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& InEffect) const { return false; }
 
+	virtual void ResolveNativeDispatch() const override;
+
 	/** EffectType 访问器；C++ 子类 override 返回具体类型，蓝图子类通过 Class Defaults 填充。 */
 	virtual UScriptStruct* GetEffectType() const override { return EffectType; }
 
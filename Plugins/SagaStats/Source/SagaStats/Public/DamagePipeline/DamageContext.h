@@ -4,11 +4,13 @@
 * Description:  SagaStats offers modular damage process and meter systems to support adaptable status management
 ****************************************************************************************************************/
 
-// DamageContext.h — UDamageContext: 单次伤害事件的共享上下文
+// DamageContext.h — FDamageContext: 单次伤害事件的共享上下文 + UDamageContext 蓝图包装
 #pragma once
 
 #include "CoreMinimal.h"
 #include "StructUtils/InstancedStruct.h"
+#include "StructUtils/StructView.h"
+#include "UObject/StrongObjectPtr.h"
 #include "DamageContext.generated.h"
 
 // Forward declarations for friend classes（访问分层，详见下方注释）
@@ -16,15 +18,102 @@ class UDamagePipeline;
 class UDamagePipelineResults;
 class UDamageCondition_Effect;
 class UDamageOperationBase;
+class UDamageContext;
+class FReferenceCollector;
 
 /**
- * UDamageContext
- * 单次伤害事件的共享上下文。
+ * FDamageEffectLayout — EffectType → 稠密 Slot 的映射表 + Effect Arena 布局。
+ *
+ * 由 UDamagePipeline::Build 生成（产出 + Condition 消费的全部 EffectType），
+ * Finalize 后不可变，由 Pipeline 与所有执行过它的 Context 共享。
  *
- * 统一存储：TMap<UScriptStruct*, FInstancedStruct>
+ * Arena 布局：每个 Slot 在 Context 的连续 Arena 中占据固定偏移（按 struct 对齐），
+ * ArenaSize 在 Build 后即已知，Context 一次性分配即可容纳一次伤害事件的全部 Effect。
+ */
+struct SAGASTATS_API FDamageEffectLayout
+{
+	UE_NONCOPYABLE(FDamageEffectLayout);
+
+	FDamageEffectLayout() = default;
+	~FDamageEffectLayout();
+
+	/** Slot → EffectType */
+	TArray<UScriptStruct*> SlotTypes;
+
+	/** Slot → Arena 内字节偏移（Finalize 后有效） */
+	TArray<int32> SlotOffsets;
+
+	/** EffectType → Slot（按类型访问的入口；框架热路径直接持有 Slot，不查此表） */
+	TMap<const UScriptStruct*, int32> SlotByType;
+
+	/** Arena 总字节数 / 对齐（Finalize 后有效） */
+	int32 ArenaSize = 0;
+	int32 ArenaAlignment = 1;
+
+	int32 Num() const { return SlotTypes.Num(); }
+
+	int32 FindSlot(const UScriptStruct* EffectType) const
+	{
+		const int32* Found = SlotByType.Find(EffectType);
+		return Found ? *Found : INDEX_NONE;
+	}
+
+	/** Slot 的默认值实例（与 Arena 同偏移），用于把复用中的 Slot 重置为默认初始化状态 */
+	const uint8* GetSlotDefault(int32 Slot) const { return DefaultArena + SlotOffsets[Slot]; }
+
+	/** 仅构建期使用：查找或追加 Slot */
+	int32 FindOrAddSlot(UScriptStruct* EffectType);
+
+	/** 构建期结束：计算 Slot 偏移与 Arena 大小，构造默认值实例 */
+	void Finalize();
+
+	bool IsFinalized() const { return bFinalized; }
+
+private:
+	/** 每个 Slot 类型的默认构造实例（布局同 Context Arena） */
+	uint8* DefaultArena = nullptr;
+
+	bool bFinalized = false;
+};
+
+using FDamageEffectLayoutPtr = TSharedPtr<const FDamageEffectLayout>;
+
+/**
+ * EmplaceEffectBySlot 之前的 Slot 状态，Operation 放弃产出时据此恢复（FDamageContext::RestoreSlot）。
+ * Slot 原本由本 Context 自身持有值（外部输入 / 同类型的先前生产者）时才拷贝一份；常见的空 Slot 不分配。
+ */
+struct FDamageSlotSnapshot
+{
+	/** 原本自身的值；无效 = 原本不存在（分叉中则可能透读父 Context） */
+	FInstancedStruct Value;
+
+	/** 分叉 Context：原本已遮蔽父 Context 的值 */
+	bool bOverridden = false;
+};
+
+/**
+ * FDamageContext
+ * 单次伤害事件的共享上下文（存储本体）。
+ *
+ * 统一存储：按 FDamageEffectLayout 排布的单块 Effect Arena + 存在位图。
  * EffectType 作为万能连接件：DamageRule:Effect 1:1 → 类型唯一确定生产者。
  * 攻击上下文和 DamageRule 产出共用同一存储——都是 typed struct。
  *
+ * Slot 布局由 Pipeline 在 Execute 时绑定（BindLayout）；布局外的类型（如未绑定前写入的
+ * 输入、Pipeline 未声明消费的外部输入）落在 ExtraEffects 中，绑定新布局时自动迁移。
+ *
+ * Arena 生命周期：绑定布局后首次写入时一次性分配；Slot 内的 struct 首次写入时构造，此后一直保持构造状态，
+ * Reset 只清存在位——下一次命中原地覆写，热路径零堆分配。
+ *
+ * 分叉（Fork）：子 Context 以写时复制方式共享父 Context 的存储——读取未被子 Context 覆盖的 Slot 时
+ * 直接读父 Context，只有推演中写入的 Effect 才在子 Context 中构造。用于 AI 推演（"现在防御会不会崩架势"），
+ * 配合 UDamagePipeline::ExecuteSpeculative 复用父 Context 已算好的、不受分歧输入影响的 Rule。
+ *
+ * 普通 C++ 对象：可放在栈上或对象池中逐次命中复用，没有 UObject 分配、命名与 GC 开销。
+ * 跨帧持有（对象池）时，其中 Effect 引用的 UObject 需由持有者经 AddReferencedObjects 上报 GC；
+ * 只在一次 Execute 内存活的栈上 Context 无需上报（执行期间 GC 不会运行）。
+ * 蓝图与 Game 扩展字段使用 UDamageContext（内含一个 FDamageContext）。
+ *
  * ============================================================================
  * 访问分层（R5 设计契约的编译期强制）
  * ============================================================================
@@ -39,19 +128,11 @@ class UDamageOperationBase;
  *   → 通过 UDamagePipelineResults 包装 API（C++ 模板 + 蓝图 CustomThunk）
  *
  * 违反契约的场景（编译期拒绝）：
- * - Condition/Operation 子类的 Evaluate/Execute 内部调 Context->GetEffect<T>() → protected 访问错误
+ * - Condition/Operation 子类的 Evaluate/Execute 内部调 Context.GetEffect<T>() → protected 访问错误
  * - 蓝图 Condition/Operation 想绕过：没有通用读写蓝图节点（v4.7 删除了旧的 UDamageContextLibrary）
- *
- * Game 扩展字段（通过 Cast<UDamageContextSubclass>(Ctx)->GameField 访问）不受影响——
- * 子类自己加的 public 字段是 Game 项目的合法扩展面。
- *
- * Blueprintable：Game 侧可蓝图继承添加上下文便利字段。
  */
-UCLASS(BlueprintType, Blueprintable)
-class SAGASTATS_API UDamageContext : public UObject
+struct SAGASTATS_API FDamageContext
 {
-	GENERATED_BODY()
-
 	// ------------------------------------------------------------------------
 	// Friend 列表 —— DSL 内部授权访问
 	// ------------------------------------------------------------------------
@@ -59,18 +140,47 @@ class SAGASTATS_API UDamageContext : public UObject
 	friend class UDamagePipelineResults;       // Game 侧读写包装（唯一的外部 API 入口）
 	friend class UDamageCondition_Effect;      // 预取自己声明的 EffectType 对应 Effect
 	friend class UDamageOperationBase;         // Operation 通过基类 ReadEffect 读上游 Effect（R5 强制留下轮）
+	friend class UDamageContext;               // 蓝图包装
 
 public:
+	FDamageContext();
+	~FDamageContext();
+
+	FDamageContext(const FDamageContext&) = delete;
+	FDamageContext& operator=(const FDamageContext&) = delete;
+
+	/** 对象池中搬移（Arena 所有权随之转移；被分叉的父 Context 在子 Context 存活期间不可搬移） */
+	FDamageContext(FDamageContext&& Other);
+	FDamageContext& operator=(FDamageContext&& Other);
+
 	// =====================================================================
 	// 公开 API（所有人可用）
 	// =====================================================================
 
-	UFUNCTION(BlueprintCallable, Category = "DamageContext")
+	/** 清空全部 Effect（下一次命中复用 Arena）；分叉的子 Context 丢弃自己的写入，回到父 Context 的状态 */
 	void Reset();
 
-	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "DamageContext")
+	/**
+	 * 写时复制分叉：子 Context 共享本 Context 的全部 Effect，写入只落在子 Context 中。
+	 * 本 Context 须在子 Context 存活期间保持存活且不被修改（写入 / Reset / 绑定新布局 / 搬移）；
+	 * 子 Context 绑定其他布局时先把可见的 Effect 全部拷入自身，脱离父 Context。
+	 */
+	FDamageContext Fork() const;
+
+	/** 分叉来源；非分叉 Context 为 nullptr */
+	const FDamageContext* GetParent() const { return Parent; }
+
 	FString DumpToString() const;
 
+	/** 包装本 Context 的 UDamageContext（蓝图 / Game 扩展字段入口）；栈上 / 池中的裸 Context 为 nullptr */
+	UDamageContext* GetOwner() const { return Owner; }
+
+	/** 进程内唯一的 Context 编号（追踪记录用） */
+	uint32 GetContextId() const { return ContextId; }
+
+	/** 上报 Arena 与 ExtraEffects 中 Effect 引用的 UObject */
+	void AddReferencedObjects(FReferenceCollector& Collector, const UObject* ReferencingObject = nullptr);
+
 protected:
 	// =====================================================================
 	// Effect 读写 API（protected —— 只对 friend 开放）
@@ -81,35 +191,257 @@ protected:
 	template<typename T>
 	void SetEffect(const T& Value)
 	{
-		DamageEffects.Add(T::StaticStruct(), FInstancedStruct::Make<T>(Value));
+		SetEffectMemory(T::StaticStruct(), &Value);
 	}
 
 	template<typename T>
 	const T* GetEffect() const
 	{
-		if (const FInstancedStruct* Found = DamageEffects.Find(T::StaticStruct()))
-		{
-			return Found->GetPtr<T>();
-		}
-		return nullptr;
+		return static_cast<const T*>(FindEffectMemory(T::StaticStruct()));
 	}
 
 	template<typename T>
 	bool HasEffect() const
 	{
-		return DamageEffects.Contains(T::StaticStruct());
+		return FindEffectMemory(T::StaticStruct()) != nullptr;
 	}
 
 	// ---- C++ 运行时 API（UScriptStruct*，供框架使用）----
 
 	void SetEffectByType(const FInstancedStruct& Value);
 	FInstancedStruct GetEffectByType(UScriptStruct* EffectType) const;
+
+	/** 按类型取只读视图（不拷贝）；不存在返回无效视图 */
+	FConstStructView GetEffectViewByType(const UScriptStruct* EffectType) const;
 	bool HasEffectByType(UScriptStruct* EffectType) const;
 
-	const TMap<TObjectPtr<UScriptStruct>, FInstancedStruct>& GetAllDamageEffects() const { return DamageEffects; }
+	/** 遍历所有 Effect（调试 / 导出用，按 Slot 顺序，布局外类型在后） */
+	TArray<FConstStructView> GetAllDamageEffects() const;
+
+	/** 可见 Effect 的类型集合的哈希（不构造视图、不分配；导出去重用） */
+	uint32 HashEffectTypes() const;
+
+	// ---- Slot API（Pipeline 热路径：Slot 来自 Build，O(1) Arena 偏移）----
+
+	/** 绑定 Slot 布局；与当前布局不同时把已有 Effect 迁移到新 Slot */
+	void BindLayout(const FDamageEffectLayoutPtr& InLayout);
+
+	/** 脱离父 Context：把经父链可见的 Effect 拷入自身，之后不再读穿父 Context */
+	void Detach();
+
+	bool HasEffectBySlot(int32 Slot) const
+	{
+		if (PresentSlots[Slot]) return true;
+		if (!Parent || OverriddenSlots[Slot]) return false;
+		// 父 Context 换过布局时 Slot 序号不再对应，按类型回落
+		return Parent->Layout == Layout ? Parent->HasEffectBySlot(Slot) : Parent->HasEffectByType(Layout->SlotTypes[Slot]);
+	}
+	void SetEffectBySlot(int32 Slot, const FInstancedStruct& Value);
+
+	/** Slot 中 Effect 的只读视图；不存在返回无效视图 */
+	FConstStructView GetEffectViewBySlot(int32 Slot) const;
+
+	/**
+	 * 把 Slot 重置为默认初始化状态、标记存在，并返回指向 Arena 的可写视图。
+	 * Operation 直接在视图上填字段（原地产出，无临时对象、无拷贝）。
+	 */
+	FStructView EmplaceEffectBySlot(int32 Slot, FDamageSlotSnapshot* OutSnapshot = nullptr);
+
+	/** Operation 放弃产出时回滚 EmplaceEffectBySlot：恢复 Emplace 前的值 / 存在位 / 遮蔽位 */
+	void RestoreSlot(int32 Slot, const FDamageSlotSnapshot& Snapshot);
+
+	/** 清除 Slot 的存在位；分叉 Context 中同时遮蔽父 Context 的值 */
+	void RemoveEffectBySlot(int32 Slot)
+	{
+		PresentSlots[Slot] = false;
+		if (Parent) OverriddenSlots[Slot] = true;
+	}
+
+	/** 分叉 Context：Slot 已被自身写入或遮蔽（不再透读父 Context） */
+	bool IsSlotOverridden(int32 Slot) const { return Parent && OverriddenSlots[Slot]; }
+
+	/** 分叉 Context：撤销自身对 Slot 的写入 / 遮蔽，重新透读父 Context */
+	void RevertSlot(int32 Slot)
+	{
+		PresentSlots[Slot] = false;
+		if (Parent) OverriddenSlots[Slot] = false;
+	}
+
+	/** 预先构造全部尚未构造的 Slot（不标记存在）：之后首次 EmplaceEffectBySlot 也走原地覆写 */
+	void ConstructAllSlots();
 
 private:
-	/** DamageEffect 存储（UScriptStruct* key —— 类型即 key） */
-	UPROPERTY()
-	TMap<TObjectPtr<UScriptStruct>, FInstancedStruct> DamageEffects;
+	/** 按类型写入：有 Slot 走 Slot，否则落入 ExtraEffects */
+	void SetEffectMemory(const UScriptStruct* EffectType, const void* Memory);
+
+	/** 按类型查找：不存在返回 nullptr */
+	const void* FindEffectMemory(const UScriptStruct* EffectType) const;
+
+	/** Slot 写入（Slot 已构造则原地拷贝赋值，不重新分配） */
+	void SetSlotMemory(int32 Slot, const void* Memory);
+
+	/** 按需分配 Arena（首次写入时；分叉 Context 不写入就不分配） */
+	void EnsureArena()
+	{
+		if (!EffectArena) AllocateArena();
+	}
+
+	void AllocateArena();
+
+	/** Slot 在 Arena 中的地址 */
+	uint8* GetSlotMemory(int32 Slot) const { return EffectArena + Layout->SlotOffsets[Slot]; }
+
+	/** 析构 Arena 中所有已构造的 struct 并释放 Arena */
+	void ReleaseArena();
+
+	/** 收集全部可见 Effect，重置存储并脱离父 Context，再按 InLayout 重新落位 */
+	void RebindLayout(const FDamageEffectLayoutPtr& InLayout);
+
+	/** 当前绑定的 Slot 布局（nullptr = 尚未被任何 Pipeline 执行） */
+	FDamageEffectLayoutPtr Layout;
+
+	/** Effect Arena（大小 / 对齐来自 Layout；GC 引用经 AddReferencedObjects 上报） */
+	uint8* EffectArena = nullptr;
+
+	/** Slot 内 struct 已构造（首次写入时置位，直到 Arena 释放） */
+	TBitArray<> ConstructedSlots;
+
+	/** Slot 存在位图（Reset 只清此位图）；分叉 Context 中只表示自身写入的 Slot */
+	TBitArray<> PresentSlots;
+
+	/** 分叉来源（写时复制的读取回退） */
+	const FDamageContext* Parent = nullptr;
+
+	/** 分叉 Context：自身写入或遮蔽过的 Slot（置位后不再透读父 Context）；非分叉 Context 为空 */
+	TBitArray<> OverriddenSlots;
+
+	/** 布局外的 Effect（UScriptStruct* key —— 类型即 key；GC 引用经 AddReferencedObjects 上报） */
+	TMap<UScriptStruct*, FInstancedStruct> ExtraEffects;
+
+	/** 蓝图包装（由 UDamageContext 构造时写入） */
+	UDamageContext* Owner = nullptr;
+
+	uint32 ContextId = 0;
+};
+
+/**
+ * UDamageContext
+ * FDamageContext 的蓝图包装：蓝图 Pipeline 调用、蓝图 Condition / Operation 的 Context 参数、
+ * Game 侧子类扩展字段（通过 Cast<UDamageContextSubclass>(Ctx)->GameField 访问）。
+ *
+ * Effect 存储与访问契约全部在内含的 FDamageContext 上；本类的 protected Effect API 只是转发，
+ * friend 列表与 FDamageContext 一致。
+ *
+ * 每次命中都 NewObject 会带来 UObject 分配、命名与 GC 压力——高频路径请直接使用栈上 / 池中的
+ * FDamageContext 调 UDamagePipeline::ExecuteNative；需要蓝图访问或 Game 扩展字段时再用本类。
+ *
+ * Game 扩展字段不受访问契约影响——子类自己加的 public 字段是 Game 项目的合法扩展面。
+ *
+ * Blueprintable：Game 侧可蓝图继承添加上下文便利字段。
+ */
+UCLASS(BlueprintType, Blueprintable)
+class SAGASTATS_API UDamageContext : public UObject
+{
+	GENERATED_BODY()
+
+	// ------------------------------------------------------------------------
+	// Friend 列表 —— DSL 内部授权访问
+	// ------------------------------------------------------------------------
+	friend class UDamagePipeline;              // Build/Execute 内部读写
+	friend class UDamagePipelineResults;       // Game 侧读写包装（唯一的外部 API 入口）
+	friend class UDamageCondition_Effect;      // 预取自己声明的 EffectType 对应 Effect
+	friend class UDamageOperationBase;         // Operation 通过基类 ReadEffect 读上游 Effect（R5 强制留下轮）
+
+public:
+	UDamageContext();
+
+	// =====================================================================
+	// 公开 API（所有人可用）
+	// =====================================================================
+
+	UFUNCTION(BlueprintCallable, Category = "DamageContext")
+	void Reset() { Native.Reset(); }
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "DamageContext")
+	FString DumpToString() const { return Native.DumpToString(); }
+
+	/**
+	 * 写时复制分叉（见 FDamageContext::Fork）：同类的新 Context，Game 扩展字段从本对象拷贝，
+	 * Effect 共享本对象的存储。子 Context 存活期间本对象保持存活，且不应再被修改。
+	 */
+	UFUNCTION(BlueprintCallable, Category = "DamageContext")
+	UDamageContext* Fork();
+
+	/**
+	 * 内含的存储本体（其 Effect API 同样 protected，暴露不破坏访问契约）。
+	 * 执行路径以 FDamageContext 为准；Pipeline / Condition / Operation / Predicate 接受 UDamageContext 的重载
+	 * 都只是经此转发，保留给按 UDamageContext 调用的既有代码。
+	 */
+	FDamageContext& GetNativeContext() { return Native; }
+	const FDamageContext& GetNativeContext() const { return Native; }
+
+	// UObject：Arena 中的 struct 可能持有 UObject 引用，需手动上报 GC
+	static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
+	virtual void BeginDestroy() override;
+
+protected:
+	// =====================================================================
+	// Effect 读写 API（protected —— 只对 friend 开放；转发到 FDamageContext）
+	// =====================================================================
+
+	template<typename T>
+	void SetEffect(const T& Value) { Native.SetEffect<T>(Value); }
+
+	template<typename T>
+	const T* GetEffect() const { return Native.GetEffect<T>(); }
+
+	template<typename T>
+	bool HasEffect() const { return Native.HasEffect<T>(); }
+
+	void SetEffectByType(const FInstancedStruct& Value) { Native.SetEffectByType(Value); }
+	FInstancedStruct GetEffectByType(UScriptStruct* EffectType) const { return Native.GetEffectByType(EffectType); }
+	FConstStructView GetEffectViewByType(const UScriptStruct* EffectType) const { return Native.GetEffectViewByType(EffectType); }
+	bool HasEffectByType(UScriptStruct* EffectType) const { return Native.HasEffectByType(EffectType); }
+	TArray<FConstStructView> GetAllDamageEffects() const { return Native.GetAllDamageEffects(); }
+
+private:
+	FDamageContext Native;
+
+	/** 分叉来源（保活：Native 透读其存储） */
+	UPROPERTY(Transient)
+	TObjectPtr<UDamageContext> ForkParent;
+};
+
+// ============================================================================
+// FDamageScriptContext — 蓝图事件的 Context 参数
+// ============================================================================
+
+/**
+ * 蓝图 Condition / Operation 事件的签名只接受 UDamageContext。Context 有 Owner 时直接传 Owner；
+ * 裸 FDamageContext（栈上 / 批量 / 分叉）没有 UObject，此时借出一个代理 UDamageContext，
+ * 其存储是 Context 的写时复制分叉：蓝图可读到全部 Effect，写入不回流。作用域结束即与 Context 脱钩并归还。
+ *
+ * 代理在 GameThread 上按嵌套深度池化（蓝图事件里再执行 Pipeline 时逐层占用一个），稳态不分配 UObject；
+ * 蓝图不应在事件之外持有它。代理是基类 UDamageContext——蓝图里 Cast 到 Game 子类会失败；
+ * 依赖 Game 扩展字段的 Pipeline 应以 UDamageContext 执行。只在经蓝图事件分发时构造（原生实现不需要）。
+ */
+class SAGASTATS_API FDamageScriptContext
+{
+public:
+	explicit FDamageScriptContext(const FDamageContext* Context);
+	~FDamageScriptContext();
+
+	FDamageScriptContext(const FDamageScriptContext&) = delete;
+	FDamageScriptContext& operator=(const FDamageScriptContext&) = delete;
+
+	UDamageContext* Get() const { return Owner; }
+
+private:
+	UDamageContext* Owner = nullptr;
+
+	/** 从 GameThread 池借出的代理（析构时归还） */
+	UDamageContext* PooledProxy = nullptr;
+
+	/** 非 GameThread 分发时的一次性代理 */
+	TStrongObjectPtr<UDamageContext> TransientProxy;
 };
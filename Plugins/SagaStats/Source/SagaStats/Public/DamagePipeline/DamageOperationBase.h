@@ -9,14 +9,19 @@
 
 #include "CoreMinimal.h"
 #include "StructUtils/InstancedStruct.h"
+#include "StructUtils/StructView.h"
 #include "DamagePipeline/DamageContext.h"
 #include "DamageOperationBase.generated.h"
 
 /**
  * UDamageOperationBase — DamageOperation 逻辑的抽象基类。
  *
- * Execute(Context, OutEffect) — 框架传入默认初始化的 OutEffect，Operation 只需填字段。
- * DamagePipeline 负责创建 OutEffect 和写入 Context。Operation 不感知 Context 写入。
+ * ExecuteInPlace(Context, OutEffect) — 框架把 Context Arena 中已默认初始化的 Slot 以 FStructView
+ * 交给 Operation，Operation 只需原地填字段。DamagePipeline 负责分配 Slot 和写入 Context。
+ * Operation 不感知 Context 写入。
+ *
+ * 蓝图子类 override Execute 事件（FInstancedStruct& 签名）；基类 ExecuteInPlace 默认实现
+ * 把同一个视图桥接到该事件——蓝图路径与原生路径共用同一个 Slot。
  *
  * ============================================================================
  * EffectType 声明：C++ / 蓝图 双路径（对齐 UDamageCondition_Effect 的模式）
@@ -30,7 +35,12 @@
  *     class UDamageOperation_Guard : public UDamageOperationBase
  *     {
  *         UDamageOperation_Guard() { EffectType = FGuardEffect::StaticStruct(); }
- *         virtual void Execute_Implementation(UDamageContext* Ctx, FInstancedStruct& OutEffect) override;
+ *         virtual bool ExecuteInPlace(FDamageContext* Ctx, FStructView OutEffect) override
+ *         {
+ *             FGuardEffect& Result = OutEffect.Get<FGuardEffect>();
+ *             Result.bGuardSuccess = ...;
+ *             return true;
+ *         }
  *     };
  *
  * - **蓝图子类**：
@@ -56,8 +66,58 @@ public:
 	virtual UScriptStruct* GetEffectType() const { return EffectType; }
 
 	/**
-	 * 执行机制逻辑。
+	 * 本 Operation 在执行中通过 ReadEffect 读取的上游 Effect 类型（R5 产销依赖声明）。
+	 * 与 Condition 消费的类型一起参与拓扑排序和拓扑分层。
+	 * C++ 子类在构造函数中填 ConsumedEffectTypes；蓝图子类在 Class Defaults 中填。
+	 */
+	virtual TArray<UScriptStruct*> GetConsumedEffectTypes() const { return ConsumedEffectTypes; }
+
+	/**
+	 * 原地执行机制逻辑（DamagePipeline 调用的入口）。
 	 * @param Context    共享上下文（读取事件上下文和上游 Effect）
+	 * @param OutEffect  指向 Context 中本 Operation 产出 Slot 的视图，已按 EffectType 默认初始化
+	 * @return           false = 放弃产出（Slot 恢复为执行前的状态：原有的值保留）
+	 *
+	 * C++ 子类 override 本函数；默认实现桥接到蓝图 Execute 事件。
+	 */
+	virtual bool ExecuteInPlace(FDamageContext* Context, FStructView OutEffect);
+
+	/** 以 UDamageContext 执行 */
+	bool ExecuteInPlace(UDamageContext* Context, FStructView OutEffect);
+	bool ExecuteInPlace(std::nullptr_t, FStructView OutEffect) { return ExecuteInPlace(static_cast<FDamageContext*>(nullptr), OutEffect); }
+
+	/**
+	 * 批量执行（UDamagePipeline::ExecuteBatch 调用）：同一 Rule 命中的全部 Context 一次交给 Operation。
+	 * @param Contexts    命中本 Rule 的 Context
+	 * @param OutEffects  与 Contexts 一一对应的产出 Slot 视图；置为无效视图 = 放弃该 Context 的产出
+	 *
+	 * 默认实现逐个调用 ExecuteInPlace。原生子类可 override 以整批处理（共享查表、向量化等）。
+	 */
+	virtual void ExecuteBatch(TArrayView<FDamageContext* const> Contexts, TArrayView<FStructView> OutEffects);
+
+	/** 以 UDamageContext 批量执行 */
+	void ExecuteBatch(TArrayView<UDamageContext* const> Contexts, TArrayView<FStructView> OutEffects);
+
+	/**
+	 * 是否可在工作线程上执行（UDamagePipeline::ExecuteBatchParallel）。
+	 * 只有原生类的声明生效——蓝图子类走 BP VM，一律视为非线程安全。
+	 */
+	bool IsThreadSafe() const { return bThreadSafe && GetClass()->HasAnyClassFlags(CLASS_Native); }
+
+	/**
+	 * Build 时由 UDamagePipeline 调用：检测本类的 Execute 事件是否被蓝图 override。
+	 * 没有 override 时默认 ExecuteInPlace 直接调用 Execute_Implementation，跳过 BlueprintNativeEvent thunk
+	 * （FindFunction + ProcessEvent）。未解析前一律走事件。
+	 */
+	void ResolveNativeDispatch();
+
+	/** Execute 是否仍经蓝图事件分发（ResolveNativeDispatch 之后有意义） */
+	bool UsesScriptDispatch() const { return bScriptExecute; }
+
+	/**
+	 * 执行机制逻辑（蓝图路径）。
+	 * @param Context    共享上下文的 UDamageContext 包装（读取 Game 扩展字段）；
+	 *                   裸 FDamageContext 执行时蓝图拿到池化的代理（见 FDamageScriptContext），原生实现拿到 nullptr
 	 * @param OutEffect  处理输出的 Effect ,类型根据 EffectType 确定
 	 */
 	UFUNCTION(BlueprintNativeEvent, Category = "DamageRule")
@@ -66,17 +126,30 @@ public:
 	virtual void Execute_Implementation(UDamageContext* Context, UPARAM(ref) FInstancedStruct& OutEffect) {}
 
 	/**
-	 * 子类读取上游 Effect 的便利接口。基类是 UDamageContext 的 friend，能访问 protected GetEffect。
+	 * 子类读取上游 Effect 的便利接口。基类是 FDamageContext / UDamageContext 的 friend，能访问 protected GetEffect。
 	 *
-	 * 注意：本接口**不做 R5 产销依赖校验**——Operation 目前可读任意 Effect 而不声明依赖（已知漏洞）。
-	 * R5 强制留到后续：Operation 侧需要引入 ConsumesEffectTypes 声明 + Build 时校验。
+	 * 读取的类型必须在 ConsumedEffectTypes 中声明：未声明的读取不参与排序与分层，
+	 * 可能读到未产出的值，在 bParallelLevels 下还会与同层写入构成数据竞争。
+	 * 本接口本身不做校验。
 	 */
+	template<typename T>
+	static const T* ReadEffect(const FDamageContext* Context)
+	{
+		return Context ? Context->GetEffect<T>() : nullptr;
+	}
+
 	template<typename T>
 	static const T* ReadEffect(const UDamageContext* Context)
 	{
 		return Context ? Context->GetEffect<T>() : nullptr;
 	}
 
+	template<typename T>
+	static const T* ReadEffect(std::nullptr_t)
+	{
+		return nullptr;
+	}
+
 protected:
 	/**
 	 * 蓝图子类在 Blueprint Class Defaults 中设置；C++ 子类通过 override `GetEffectType()` 替代。
@@ -88,7 +161,21 @@ protected:
 		meta = (EditCondition = "IsClassDefaultContext", EditConditionHides))
 	UScriptStruct* EffectType = nullptr;
 
+	/** 执行中读取的上游 Effect 类型；与 EffectType 一样是类级属性，非 CDO 实例上隐藏 */
+	UPROPERTY(EditAnywhere, Category = "DamageRule",
+		meta = (EditCondition = "IsClassDefaultContext", EditConditionHides))
+	TArray<UScriptStruct*> ConsumedEffectTypes;
+
+	/**
+	 * C++ 子类在构造函数中置 true，声明 ExecuteInPlace / ExecuteBatch 只读写传入的 Context 与 OutEffect。
+	 * 并行执行时每个工作线程持有独立的 Operation 实例，实例成员可作线程内暂存。
+	 */
+	bool bThreadSafe = false;
+
 private:
+	/** Execute 事件有蓝图 override（由 ResolveNativeDispatch 写入；默认 true = 走事件） */
+	bool bScriptExecute = true;
+
 	/** EditCondition 驱动函数：CDO/Archetype 返回 true → EffectType 可见可编辑；普通实例返回 false → 隐藏 */
 	UFUNCTION()
 	bool IsClassDefaultContext() const { return HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject); }
@@ -10,8 +10,11 @@
 #include "CoreMinimal.h"
 #include "Engine/DataAsset.h"
 #include "DamagePipeline/DamageRule.h"
+#include "DamagePipeline/CompiledDamagePipeline.h"
 #include "DamagePipeline.generated.h"
 
+struct FDamagePlanKey;
+
 /**
  * 稳定拓扑排序的结果。
  */
@@ -24,6 +27,10 @@ struct SAGASTATS_API FPipelineSortResult
 	UPROPERTY(BlueprintReadOnly)
 	TArray<TObjectPtr<UDamageRule>> SortedRules;
 
+	/** 因不影响 ObservedEffects 而被裁剪的 Rule（按声明顺序；ObservedEffects 为空时不裁剪） */
+	UPROPERTY(BlueprintReadOnly)
+	TArray<TObjectPtr<UDamageRule>> PrunedRules;
+
 	/** 如果检测到循环依赖则为 true */
 	UPROPERTY(BlueprintReadOnly)
 	bool bHasCycle = false;
@@ -48,6 +55,124 @@ struct SAGASTATS_API FRuleExecutionEntry
 	bool bExecuted = false;
 };
 
+/**
+ * 单次执行的紧凑结果：按编译计划下标（排序后位置）记录每条 Rule 是否执行、是否写入了产出。
+ * 128 条 Rule 以内位图内联存储、无堆分配；Rule 名不随结果复制，
+ * 需要调试视图时经 UDamagePipeline::MakeExecutionLog / GetCompiledRule 解析。
+ */
+struct SAGASTATS_API FDamageExecutionResult
+{
+	/** 谓词通过（Operation 已调用） */
+	TBitArray<> Executed;
+
+	/** Operation 写入了产出（谓词通过且未放弃产出）；ExecuteSpeculative 据此判断父 Context 中的 Slot 值来自哪里 */
+	TBitArray<> Produced;
+
+	void Reset(int32 NumRules)
+	{
+		Executed.Init(false, NumRules);
+		Produced.Init(false, NumRules);
+	}
+
+	int32 Num() const { return Executed.Num(); }
+
+	bool WasExecuted(int32 RuleIndex) const { return Executed.IsValidIndex(RuleIndex) && Executed[RuleIndex]; }
+
+	bool WasProduced(int32 RuleIndex) const { return Produced.IsValidIndex(RuleIndex) && Produced[RuleIndex]; }
+
+	int32 CountExecuted() const { return Executed.CountSetBits(); }
+};
+
+/** 烘焙计划中的单条 Rule（FCompiledDamageRule 的可序列化形式；Operation 按 Rule->OperationClass 重建） */
+USTRUCT()
+struct SAGASTATS_API FDamageCookedRule
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<UDamageRule> Rule;
+
+	UPROPERTY()
+	int32 PredicateStart = 0;
+
+	UPROPERTY()
+	int32 PredicateNum = 0;
+
+	UPROPERTY()
+	int32 EffectSlot = INDEX_NONE;
+
+	UPROPERTY()
+	int32 ReadSlotStart = 0;
+
+	UPROPERTY()
+	int32 ReadSlotNum = 0;
+};
+
+/** 烘焙计划中的共享子谓词（FDamagePredicateSubexpr 的可序列化形式） */
+USTRUCT()
+struct SAGASTATS_API FDamageCookedSubexpr
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 Start = 0;
+
+	UPROPERTY()
+	int32 Num = 0;
+
+	UPROPERTY()
+	float Cost = 0.f;
+
+	UPROPERTY()
+	TObjectPtr<UDamagePredicate> Representative;
+};
+
+/**
+ * 烘焙计划：Cook 时随 Pipeline 资产序列化的 FCompiledDamagePipeline。
+ * 加载后首次执行时校验 ContentHash（Rule 集合、ObservedEffects、谓词内容的跨进程稳定哈希），
+ * 一致则直接恢复计划、跳过排序与编译；不一致（或格式版本变化）时照常编译。
+ * 分层、线程安全标记、记忆安全性等派生数据不序列化，恢复时由 Finish 重新计算。
+ * Condition / 子谓词的内容哈希同样不序列化（指针哈希只在本进程有效），恢复时按对象重新计算。
+ */
+USTRUCT()
+struct SAGASTATS_API FDamageCookedPlan
+{
+	GENERATED_BODY()
+
+	/** 格式版本；字节码或字段含义变化时递增，旧数据随之作废 */
+	static constexpr int32 CurrentVersion = 2;
+
+	UPROPERTY()
+	int32 Version = 0;
+
+	UPROPERTY()
+	uint32 ContentHash = 0;
+
+	/** Slot 布局（按 Slot 顺序） */
+	UPROPERTY()
+	TArray<TObjectPtr<UScriptStruct>> SlotTypes;
+
+	UPROPERTY()
+	TArray<FDamageCookedRule> Rules;
+
+	/** 谓词字节码，每条指令打包为 Operand << 16 | bNegate << 8 | Op */
+	UPROPERTY()
+	TArray<int64> PredicateCode;
+
+	UPROPERTY()
+	TArray<TObjectPtr<UDamageCondition>> Conditions;
+
+	UPROPERTY()
+	TArray<FDamageCookedSubexpr> Subexprs;
+
+	UPROPERTY()
+	TArray<int32> ReadSlots;
+
+	bool IsValid() const { return Version == CurrentVersion; }
+
+	void Reset() { *this = FDamageCookedPlan(); }
+};
+
 /**
  * UDamagePipeline — 自洽的 Pipeline 定义 + 执行引擎。
  *
@@ -65,6 +190,22 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	TArray<TObjectPtr<UDamageRule>> DamageRules;
 
+	/**
+	 * 外部观测的输出 Effect（游戏经 UDamagePipelineResults 读取的类型）。
+	 * 非空时 Build 裁剪所有不（经产销关系传递地）影响这些类型的 Rule，结果见 FPipelineSortResult::PrunedRules。
+	 * 为空时不裁剪（所有 Rule 都视为可观测）。
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Damage Pipeline")
+	TArray<TObjectPtr<UScriptStruct>> ObservedEffects;
+
+	/**
+	 * 攻击方（源）侧的外部输入 Effect（如 FSekiroAttackContext）；其余外部输入视为目标侧。
+	 * Build 据此把 Rule 分为源阶段（只传递地依赖源侧输入）与目标阶段，供 ExecuteMultiTarget 使用。
+	 * 修改后需重新 Build。
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Damage Pipeline")
+	TArray<TObjectPtr<UScriptStruct>> SourceEffects;
+
 	// =====================================================================
 	// 核心 API
 	// =====================================================================
@@ -78,46 +219,325 @@ public:
 	FPipelineSortResult Build();
 
 	/**
-	 * 执行管线。未烘焙则自动 Build()。
-	 * 按缓存的拓扑顺序：评估 Condition → 执行 DamageOperation → 返回执行日志。
+	 * 执行管线（原生入口）。未烘焙则自动 Build()。
+	 * 按编译计划（CompiledPlan）顺序：评估 Condition → 执行 DamageOperation。
+	 * @param OutResult    按编译计划下标的已执行位图
+	 * @param OutExecuted  可选：调用方提供的输出区（长度 >= GetNumCompiledRules()），逐 Rule 写入是否执行
+	 * @return             false = 无法执行（循环依赖 / Context 为空）
+	 *
+	 * 高频路径直接传栈上 / 池中的 FDamageContext（无 UObject 分配），Context 在调用期间独占。
+	 */
+	bool ExecuteNative(FDamageContext* Context, FDamageExecutionResult& OutResult, TArrayView<bool> OutExecuted = {});
+
+	/** UDamageContext 包装的原生入口（蓝图 Condition / Operation 收到该包装） */
+	bool ExecuteNative(UDamageContext* Context, FDamageExecutionResult& OutResult, TArrayView<bool> OutExecuted = {});
+
+	/** 字面量 nullptr 消歧（两种 Context 指针都可由其转换）；总是返回 false */
+	bool ExecuteNative(std::nullptr_t, FDamageExecutionResult& OutResult, TArrayView<bool> OutExecuted = {})
+	{
+		return ExecuteNative(static_cast<FDamageContext*>(nullptr), OutResult, OutExecuted);
+	}
+
+	/**
+	 * 执行管线（蓝图入口）：ExecuteNative 的包装，把结果展开为带 Rule 名的执行日志。
 	 */
 	UFUNCTION(BlueprintCallable, Category = "Damage Pipeline")
 	TArray<FRuleExecutionEntry> Execute(UDamageContext* Context);
 
+	/**
+	 * 按需执行（原生入口）：只运行产出 RequestedEffects 所需的 Rule（沿产销关系从请求类型反向遍历）。
+	 * 适用于只关心个别结果的调用方（AI 威胁估算只要最终伤害、UI 预览只要架势值）。
+	 * 子计划按请求集合缓存在本 Pipeline 中，重复请求不再遍历依赖图。子计划外的 Rule 记为未执行。
+	 * 不导出 Mermaid。
+	 */
+	bool ExecuteForNative(FDamageContext* Context, TConstArrayView<UScriptStruct*> RequestedEffects, FDamageExecutionResult& OutResult);
+	bool ExecuteForNative(UDamageContext* Context, TConstArrayView<UScriptStruct*> RequestedEffects, FDamageExecutionResult& OutResult);
+	bool ExecuteForNative(std::nullptr_t, TConstArrayView<UScriptStruct*> RequestedEffects, FDamageExecutionResult& OutResult)
+	{
+		return ExecuteForNative(static_cast<FDamageContext*>(nullptr), RequestedEffects, OutResult);
+	}
+
+	/** 按需执行（蓝图入口）：ExecuteForNative 的包装 */
+	UFUNCTION(BlueprintCallable, Category = "Damage Pipeline")
+	TArray<FRuleExecutionEntry> ExecuteFor(UDamageContext* Context, const TArray<UScriptStruct*>& RequestedEffects);
+
+	/**
+	 * 推演执行（AI 评估候选行动）：在父 Context 的分叉上执行，复用父 Context 已算好的结果。
+	 * 分叉中写入的 Effect 视为分歧输入；沿拓扑序只重跑读取了分歧 Slot（含重跑 Rule 的产出）的 Rule，
+	 * 其余 Rule 的执行结果取自 ParentResult、产出直接透读父 Context。结果与在"父 Context 的输入 + 分叉写入"
+	 * 上完整执行一致。
+	 * @param Fork          FDamageContext::Fork 得到的子 Context；逐个评估候选时先 Reset 再写入分歧输入
+	 * @param ParentResult  父 Context 由本 Pipeline 执行的结果（规则数不符时退化为全量重跑；父 Context 未绑定当前布局时先脱离再全量重跑）
+	 * 有多个写入者的 Slot 父 Context 只保留最终值，这类 Slot 总视为分歧、其写入者总是重跑。
+	 * 父 Context 中 Slot 的值是否来自 Rule 按 ParentResult.Produced 判断（放弃产出的 Operation 不覆盖预填值）。
+	 * 分歧只按 Effect 追踪——分叉后修改的 Game 扩展字段不会触发重跑。不导出 Mermaid。
+	 */
+	bool ExecuteSpeculative(FDamageContext* Fork, const FDamageExecutionResult& ParentResult, FDamageExecutionResult& OutResult);
+	bool ExecuteSpeculative(UDamageContext* Fork, const FDamageExecutionResult& ParentResult, FDamageExecutionResult& OutResult);
+	bool ExecuteSpeculative(std::nullptr_t, const FDamageExecutionResult& ParentResult, FDamageExecutionResult& OutResult)
+	{
+		return ExecuteSpeculative(static_cast<FDamageContext*>(nullptr), ParentResult, OutResult);
+	}
+
+	/**
+	 * 多目标执行（AoE：一次攻击命中多个目标）：源阶段 Rule 每次攻击只执行一次，
+	 * 目标阶段 Rule 在每个目标的分叉 Context 上执行，共享源阶段的产出。结果与逐目标完整执行一致。
+	 * @param SourceInputs  源侧输入（攻击上下文等），写入 OutSource
+	 * @param TargetInputs  每个目标的目标侧输入
+	 * @param OutSource     源阶段的 Context（须在 OutTargets 使用期间保持存活、不被修改）
+	 * @param OutTargets    每个目标一个 OutSource 的分叉；传入上一次的结果可复用其 Arena
+	 * @param OutResults    可选：每个目标的完整执行结果（源阶段 Rule 的位取自源阶段）
+	 * 目标输入写入了源阶段读写的类型时，该目标退化为完整执行（Warning 日志）。
+	 */
+	bool ExecuteMultiTarget(TConstArrayView<FInstancedStruct> SourceInputs,
+		TConstArrayView<TArray<FInstancedStruct>> TargetInputs,
+		FDamageContext& OutSource, TArray<FDamageContext>& OutTargets,
+		TArray<FDamageExecutionResult>* OutResults = nullptr);
+
+	/** Rule 是否属于目标阶段（依赖目标侧输入）；越界返回 true */
+	bool IsTargetStageRule(int32 RuleIndex) const { return !TargetStageRules.IsValidIndex(RuleIndex) || TargetStageRules[RuleIndex]; }
+
+	// ---- 执行结果解析（调试视图，按需调用）----
+
+	/** 编译计划中的 Rule 数（FDamageExecutionResult 的位数） */
+	int32 GetNumCompiledRules() const { return CompiledPlan->Rules.Num(); }
+
+	/** 编译计划下标对应的 Rule；越界返回 nullptr */
+	UDamageRule* GetCompiledRule(int32 RuleIndex) const;
+
+	/** Rule 在编译计划中的下标；未编译 / 不在计划中返回 INDEX_NONE */
+	int32 FindCompiledRuleIndex(const UDamageRule* Rule) const;
+
+	/** 把位图结果展开为带 Rule 名的执行日志 */
+	TArray<FRuleExecutionEntry> MakeExecutionLog(const FDamageExecutionResult& Result) const;
+
+	/**
+	 * 批量执行（AoE / 多段命中：同一帧产生的多个 Context）。
+	 * 按 Rule 为主序遍历：每条 Rule 对全部 Context 评估谓词、再一次性交给 Operation::ExecuteBatch，
+	 * 然后进入下一条 Rule。各 Context 互相独立，结果与逐个 Execute 相同。
+	 * 不输出逐 Rule 日志、不导出 Mermaid。
+	 * @param OutExecutionLogs  可选：每个 Context 一份执行日志，顺序与 Contexts 一致（null Context 对应空日志）
+	 */
+	void ExecuteBatch(TArrayView<FDamageContext* const> Contexts,
+		TArray<TArray<FRuleExecutionEntry>>* OutExecutionLogs = nullptr);
+	void ExecuteBatch(TArrayView<UDamageContext* const> Contexts,
+		TArray<TArray<FRuleExecutionEntry>>* OutExecutionLogs = nullptr);
+
+	/**
+	 * 并行批量执行：把 Contexts 切成连续分块，经 ParallelFor 分发到工作线程，
+	 * 每块按 ExecuteBatch 的 Rule 主序执行，使用该工作线程独占的 Operation 实例。
+	 * 每个 Context 只由一个线程处理，结果与 ExecuteBatch 逐位一致（与调度无关）。
+	 *
+	 * 仅当全部 Operation / Condition 声明线程安全（IsThreadSafe）时并行；否则退化为 ExecuteBatch。
+	 * 必须在游戏线程调用（调用期间阻塞，GC 不会运行）。
+	 */
+	void ExecuteBatchParallel(TArrayView<FDamageContext* const> Contexts,
+		TArray<TArray<FRuleExecutionEntry>>* OutExecutionLogs = nullptr);
+	void ExecuteBatchParallel(TArrayView<UDamageContext* const> Contexts,
+		TArray<TArray<FRuleExecutionEntry>>* OutExecutionLogs = nullptr);
+
+	/**
+	 * 预热（加载界面等时机调用）：提前完成原本发生在首次命中上的一次性开销——
+	 * 烘焙 / 编译计划（Operation 实例化、CDO 产出类型解析、蓝图分发解析），
+	 * 为 Contexts 绑定布局、分配 Arena 并构造全部 Slot，按需预建并行批量执行的 Worker Operation。
+	 * 之后首次命中与稳态命中开销一致。AddRule / RemoveRule / Build 换用新计划后需重新预热。
+	 * @param Contexts            将被复用的 Context（null 跳过）
+	 * @param NumParallelWorkers  为 ExecuteBatchParallel 预建的 Worker 数（0 = 不预建，< 0 = 按可用工作线程数）
+	 * @return false = 无法执行（循环依赖）
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Damage Pipeline")
+	bool Warmup(const TArray<UDamageContext*>& Contexts, int32 NumParallelWorkers = 0);
+
+	/** 预热对象池中的 FDamageContext */
+	bool Warmup(TConstArrayView<FDamageContext*> Contexts, int32 NumParallelWorkers = 0);
+
 	/** 是否已烘焙 */
 	UPROPERTY(BlueprintReadOnly)
 	bool bIsBaked = false;
 
+	/**
+	 * 运行时加入 Rule（拾取 Boon 等动态组装场景），就地修补已编译的计划：
+	 * 只校验、编译新 Rule，按上下游约束插入排序结果，不重跑全量校验 / 排序 / 编译。
+	 * 以下情况退回完整 Build：新 Rule 顶替已有的同类型生产者；上下游约束冲突（需要重排或成环）。
+	 * 未烘焙时只加入 DamageRules，留给下一次 Build。
+	 * 修补后的顺序能就地判定与完整 Build 一致时才放进共享计划缓存（RemoveRule 同）。
+	 * @return false = Rule 为空 / 已在管线中 / 校验失败，或退回的 Build 失败
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Damage Pipeline")
+	bool AddRule(UDamageRule* Rule);
+
+	/**
+	 * 运行时移除 Rule，就地修补已编译的计划（剩余 Rule 的相对顺序不变）。
+	 * 被移除的 Rule 与其他 Rule 产出同一类型时退回完整 Build。
+	 * @return false = Rule 不在管线中，或退回的 Build 失败
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Damage Pipeline")
+	bool RemoveRule(UDamageRule* Rule);
+
+	/**
+	 * 单次命中按拓扑层并发执行（Build 计算分层）：同层 Rule 的谓词与 Operation 分发到工作线程。
+	 * 面向 Rule 数多、层宽的 Pipeline（Boss 重击等单次延迟敏感的场景）。
+	 * 仅当全部 Operation / Condition 声明线程安全、且最宽一层足够宽时生效，否则按串行执行。
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Damage Pipeline")
+	bool bParallelLevels = false;
+
 #if WITH_EDITOR
 	/** 编辑器中修改 DamageRules 或其内容时，自动置 bIsBaked = false */
 	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
 	virtual void PostEditChangeChainProperty(FPropertyChangedChainEvent& PropertyChangedEvent) override;
 #endif
 
+	/** Cook 时 Build 并把编译计划写入 CookedPlan */
+	virtual void PreSave(FObjectPreSaveContext ObjectSaveContext) override;
+
+	/** 向 GC 报告 CompiledPlan 引用的 Rule 与 Operation（计划不是 UPROPERTY） */
+	static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
+
 	// =====================================================================
 	// Mermaid DAG 导出
 	// =====================================================================
 
+	/**
+	 * Execute 后自动导出 Mermaid DAG（调试用）。
+	 * 导出在后台任务中格式化与写盘；同一 (Rule 集合, 执行掩码, Effect 类型集合) 每次运行只导出一次，
+	 * 并受 SagaStats.Mermaid.SampleRate / SagaStats.Mermaid.MaxExportsPerSession 限流。
+	 * 只在游戏线程导出：其他线程上的 ExecuteNative 跳过导出。
+	 */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-	bool bAutoExportMermaid = true;
+	bool bAutoExportMermaid = false;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	FString ScenarioLabel;
 
+	/** 导出一次执行的 Mermaid DAG；去重签名直接取自执行位图与 Context 的存在位，只有新签名才构造日志与快照 */
+	void ExportMermaidDAG(const FDamageExecutionResult& Result, const FDamageContext* Context) const;
+
+	/** 同上，执行状态按 Rule 名取自 ExecutionLog */
 	void ExportMermaidDAG(const TArray<FRuleExecutionEntry>& ExecutionLog,
-		const UDamageContext* Context) const;
+		const FDamageContext* Context) const;
 
 private:
 	/** 稳定拓扑排序（Kahn 算法 BFS 变体）。直接读 DamageRules 成员，无依赖的 Rule 保留原始数组顺序。 */
 	FPipelineSortResult StableTopologicalSort();
 
+	/**
+	 * AddRule 就地插入后，计划是否仍是完整 Build 的稳定序（按 DamageRules 下标字典序最小的拓扑序）。
+	 * 新 Rule 下标最大：插入位置之前的前缀不变；只需检查窗口 [InsertIndex, end)——
+	 * 其中其余 Rule 都依赖窗口内的生产者时，完整 Build 在该位置也只能排出新 Rule。
+	 */
+	static bool IsStableInsertion(const FCompiledDamagePipeline& Plan, int32 InsertIndex);
+
 	/** 烘焙后的排序结果 */
 	UPROPERTY()
 	TArray<TObjectPtr<UDamageRule>> SortedRules;
 
-	/** DamageOperation 逻辑实例缓存 */
+	/** Cook 产出的编译计划（只在 Cook 时写入；编辑器中的资产为空） */
 	UPROPERTY()
-	TMap<UClass*, TObjectPtr<UDamageOperationBase>> OperationInstances;
+	FDamageCookedPlan CookedPlan;
+
+	/**
+	 * 从 SortedRules 生成扁平执行计划：解析 Operation 实例、产出 EffectType 与 Slot、谓词字节码。
+	 * 先查 FDamagePipelinePlanCache，命中则共享已有计划；未命中则编译并加入缓存。
+	 * 由 Build() 调用；SortedRules 来自序列化（bIsBaked 已为 true）时由 Execute 懒调用。
+	 */
+	void CompilePlan(const FDamagePlanKey& Key);
+
+	/**
+	 * 切换到 Plan：按计划回写 SortedRules、登记追踪名表、划分执行阶段，作废 Worker 实例组
+	 * @param bStableOrder  Plan 的顺序是否为完整 Build 的稳定序（缓存与 Build 产出的计划总是；增量修改后未必）
+	 */
+	void AdoptPlan(const TSharedRef<FCompiledDamagePipeline>& Plan, bool bStableOrder = true);
+
+	/** 按 SourceEffects 计算 TargetStageRules / SourceStageSlots（依赖计划，也依赖本 Pipeline 的声明，不放进共享计划） */
+	void ClassifyStages();
+
+	/** 修改计划前调用：计划被共享时先复制一份私有计划（写时复制） */
+	FCompiledDamagePipeline& GetMutablePlan();
+
+	/** 按 ObservedEffects 从排序结果中移除不可达的 Rule，写入 Result.PrunedRules */
+	void PruneUnobservedRules(FPipelineSortResult& Result) const;
+
+	/** 单条 Rule 的 EffectType 校验（Build / AddRule 共用）；失败时输出 Error 日志 */
+	bool ValidateRule(const UDamageRule* Rule) const;
+
+	/** 执行前准备：未烘焙则 Build，未编译则恢复烘焙计划或 CompilePlan。返回 false = 无法执行（循环依赖） */
+	bool PrepareExecution();
+
+	/** 当前 DamageRules / ObservedEffects 的跨进程稳定哈希（烘焙计划校验用） */
+	uint32 ComputeCookedHash() const;
+
+	/** CookedPlan 与当前内容一致时恢复为编译计划（优先共享计划缓存中的同键计划）；返回是否成功 */
+	bool RestoreCookedPlan(const FDamagePlanKey& Key);
+
+	/** ExecuteBatchParallel 的 Worker 数上限（工作线程数 + 游戏线程） */
+	static int32 GetMaxBatchWorkers();
+
+	/**
+	 * Rule 主序执行一段 Context（ExecuteBatch / ExecuteBatchParallel 的公共内核）。
+	 * @param Operations    按 Rule 下标排列的 Operation 实例（某个 Worker 的实例组）
+	 * @param InputIndices  Batch[i] 在调用方 Contexts 中的原下标（回填日志用）
+	 */
+	void ExecuteBatchRange(TArrayView<FDamageContext* const> Batch,
+		TArrayView<UDamageOperationBase* const> Operations,
+		TArrayView<const int32> InputIndices,
+		TArray<TArray<FRuleExecutionEntry>>* OutExecutionLogs);
+
+	/**
+	 * 查找或生成产出 RequestedSlots（升序去重）的子计划。缓存属于本 Pipeline（共享计划不可变），
+	 * AdoptPlan 时清空；返回的引用在下一次换计划前有效。
+	 */
+	const FDamageSubPlan& FindOrBuildSubPlan(TConstArrayView<int32> RequestedSlots);
+
+	/** 确保 WorkerOperationTable 至少有 NumWorkers 组实例（游戏线程调用） */
+	void EnsureWorkerOperations(int32 NumWorkers);
+
+	/** 第 Worker 组 Operation 实例（按 Rule 下标） */
+	TArrayView<UDamageOperationBase* const> GetWorkerOperations(int32 Worker) const;
+
+	/**
+	 * 逐层执行（bParallelLevels）：每层先并发评估谓词，再串行分配产出 Slot，最后并发执行 Operation。
+	 * @param OutExecuted  按 Rule 下标写入是否执行
+	 * @param OutProduced  按 Rule 下标写入是否写入了产出
+	 */
+	void ExecuteLevels(FDamageContext* Context, TArray<bool>& OutExecuted, TArray<bool>& OutProduced);
+
+	/**
+	 * 单条编译记录的执行：评估谓词 → 执行 Operation → 写入 Context。返回是否执行
+	 * @param Memo         本次执行的谓词记忆（同一 Context 的各 Rule 共用）
+	 * @param OutProduced  可选：是否写入了产出（Operation 放弃产出时为 false）
+	 */
+	bool ExecuteCompiledRule(const FCompiledDamageRule& Compiled, FDamageContext* Context,
+		FDamagePredicateMemo* Memo = nullptr, bool* OutProduced = nullptr);
+
+	/** 编译后的执行计划（运行时产物，不序列化）；可能与 FDamagePipelinePlanCache 及其他 Pipeline 共享，修改前经 GetMutablePlan */
+	TSharedRef<FCompiledDamagePipeline> CompiledPlan = MakeShared<FCompiledDamagePipeline>();
+
+	/** CompiledPlan 的顺序是否为完整 Build 的稳定序；否则增量修改的结果不放进共享缓存 */
+	bool bPlanInStableOrder = false;
+
+	/**
+	 * 每 Worker 的 Operation 实例组，扁平存放：[Worker * Rules.Num() + RuleIndex]。
+	 * 第 0 组即 CompiledPlan 中的共享实例；其余组按类各 NewObject 一份。CompilePlan 时清空。
+	 */
+	TArray<UDamageOperationBase*> WorkerOperationTable;
+
+	/** 按 Rule 下标：是否（经产销关系传递地）依赖目标侧外部输入 */
+	TBitArray<> TargetStageRules;
+
+	/** 源阶段 Rule 读写的 Slot（目标输入写入这些 Slot 时不能共享源阶段结果） */
+	TBitArray<> SourceStageSlots;
+
+	/**
+	 * 子计划缓存：SubPlanByHash 记录每个哈希的首个子计划，同哈希的后续子计划经 NextSubPlan 串链。
+	 * 元素独立分配，已返回的引用不因后续插入失效；查找 / 插入经 SubPlanLock（ExecuteForNative 可能被并发调用）。
+	 */
+	TArray<TUniquePtr<FDamageSubPlan>> SubPlans;
+	TArray<int32> NextSubPlan;
+	TMap<uint32, int32> SubPlanByHash;
+	FCriticalSection SubPlanLock;
 
-	UDamageOperationBase* GetOrCreateOperation(TSubclassOf<UDamageOperationBase> OperationClass);
+	/** WorkerOperationTable 中第 1 组起新建的实例（只为 GC 持有） */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UDamageOperationBase>> WorkerOperationInstances;
 };
@@ -0,0 +1,89 @@
+/***************************************************************************************************************
+* Plugin:       SagaStats
+* Author:       Jinming Zhang
+* Description:  SagaStats offers modular damage process and meter systems to support adaptable status management
+****************************************************************************************************************/
+
+// DamagePipelinePlanCache.h — 全局编译计划缓存：相同 Rule 集合的 Pipeline 共享同一份 FCompiledDamagePipeline
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+
+class UDamageRule;
+struct FCompiledDamagePipeline;
+
+/**
+ * 编译计划的缓存键：Rule 资产身份（按 DamageRules 声明顺序，稳定排序依赖该顺序）+ ObservedEffects + 内容哈希。
+ * 内容哈希覆盖 OperationClass 及其 CDO 的产销声明（EffectType / ConsumedEffectTypes）与谓词树
+ * （节点类型、bReverse、叶子 Condition 的全部属性值），
+ * 同一资产被编辑后键随之变化，不会命中过期计划。
+ */
+struct SAGASTATS_API FDamagePlanKey
+{
+	TArray<const UDamageRule*> Rules;
+	TArray<const UScriptStruct*> ObservedEffects;
+	uint32 ContentHash = 0;
+
+	/** 由 DamageRules / ObservedEffects 生成键（跳过 null，与 Build 一致） */
+	static FDamagePlanKey Make(TConstArrayView<TObjectPtr<UDamageRule>> DamageRules,
+		TConstArrayView<TObjectPtr<UScriptStruct>> ObservedEffects);
+
+	bool operator==(const FDamagePlanKey& Other) const
+	{
+		return ContentHash == Other.ContentHash && Rules == Other.Rules && ObservedEffects == Other.ObservedEffects;
+	}
+};
+
+/**
+ * FDamagePipelinePlanCache — 进程级编译计划缓存。
+ *
+ * Roguelike 模式下大量玩家持有的 Boon 组合高度重复：相同 Rule 集合只编译一次，
+ * 各 UDamagePipeline 经 TSharedRef 引用计数共享同一份计划（共享计划视为不可变，
+ * 需要修改的 Pipeline 先复制一份私有计划）。
+ *
+ * 淘汰：条目数超过 SagaStats.DamagePipeline.PlanCacheCapacity 时，按 LRU 淘汰没有 Pipeline 在用的条目；
+ * 正在使用的条目不淘汰。容量 <= 0 时不缓存。
+ *
+ * 缓存条目持有的 Rule 与 Operation 经 FGCObject 报告给 GC。只在游戏线程访问。
+ */
+class SAGASTATS_API FDamagePipelinePlanCache : public FGCObject
+{
+public:
+	static FDamagePipelinePlanCache& Get();
+
+	/** 查找并刷新 LRU 时间戳；未命中返回 nullptr */
+	TSharedPtr<FCompiledDamagePipeline> Find(const FDamagePlanKey& Key);
+
+	/** 加入新编译的计划（同键已存在时替换），必要时淘汰 */
+	void Add(const FDamagePlanKey& Key, const TSharedRef<FCompiledDamagePipeline>& Plan);
+
+	void Empty();
+
+	int32 Num() const { return NumEntries; }
+
+	void LogStats() const;
+
+	//~ FGCObject
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FDamagePipelinePlanCache"); }
+
+private:
+	struct FEntry
+	{
+		FDamagePlanKey Key;
+		TSharedRef<FCompiledDamagePipeline> Plan;
+		uint64 LastUsed = 0;
+	};
+
+	/** 淘汰最久未用且无 Pipeline 引用的条目，直到不超过容量 */
+	void EvictUnused(int32 Capacity);
+
+	/** 按键哈希分桶；同桶内逐个比较完整键 */
+	TMap<uint32, TArray<FEntry, TInlineAllocator<1>>> Buckets;
+
+	int32 NumEntries = 0;
+	uint64 UseClock = 0;
+	uint64 NumHits = 0;
+	uint64 NumMisses = 0;
+};
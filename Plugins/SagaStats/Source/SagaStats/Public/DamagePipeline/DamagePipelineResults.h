@@ -21,7 +21,7 @@
  * 不是 DSL 原语内部"）。
  *
  * 设计动机：
- * - UDamageContext 的 Effect 读写 API 全部 protected 以防止 Condition/Operation
+ * - FDamageContext / UDamageContext 的 Effect 读写 API 全部 protected 以防止 Condition/Operation
  *   内部越界访问（保障 R5 契约）
  * - 但 Game 侧有合法需求：Execute 前预填攻击上下文、Execute 后读管线结果、调试遍历
  * - 本类作为 friend 授权的 Library，把"合法外部访问"与"非法内部绕过"在类型层面区分
@@ -66,7 +66,42 @@ public:
 	}
 
 	/** 遍历所有 Effect（Game 侧调试用；生产代码应走 ReadEffect<T>） */
-	static const TMap<TObjectPtr<UScriptStruct>, FInstancedStruct>& GetAllEffects(const UDamageContext* Context);
+	static TArray<FConstStructView> GetAllEffects(const UDamageContext* Context);
+
+	// ---- 同上，作用于栈上 / 池中的 FDamageContext ----
+
+	template<typename T>
+	static void WriteEffect(FDamageContext* Context, const T& Value)
+	{
+		if (Context) Context->SetEffect<T>(Value);
+	}
+
+	template<typename T>
+	static const T* ReadEffect(const FDamageContext* Context)
+	{
+		return Context ? Context->GetEffect<T>() : nullptr;
+	}
+
+	template<typename T>
+	static bool HasEffect(const FDamageContext* Context)
+	{
+		return Context ? Context->HasEffect<T>() : false;
+	}
+
+	static TArray<FConstStructView> GetAllEffects(const FDamageContext* Context);
+
+	// ---- 字面量 nullptr 消歧（两种 Context 指针都可由其转换） ----
+
+	template<typename T>
+	static void WriteEffect(std::nullptr_t, const T& Value) {}
+
+	template<typename T>
+	static const T* ReadEffect(std::nullptr_t) { return nullptr; }
+
+	template<typename T>
+	static bool HasEffect(std::nullptr_t) { return false; }
+
+	static TArray<FConstStructView> GetAllEffects(std::nullptr_t) { return {}; }
 
 	// =====================================================================
 	// 蓝图 API（CustomThunk 通配结构体引脚）
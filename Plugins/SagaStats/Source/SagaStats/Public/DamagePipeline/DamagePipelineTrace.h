@@ -0,0 +1,94 @@
+/***************************************************************************************************************
+* Plugin:       SagaStats
+* Author:       Jinming Zhang
+* Description:  SagaStats offers modular damage process and meter systems to support adaptable status management
+****************************************************************************************************************/
+
+// DamagePipelineTrace.h — Pipeline 执行追踪：每线程无锁环形缓冲 + 按需异步导出
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * 编译期开关：0 = 追踪点全部编译为空（Shipping 默认），1 = 启用。
+ * 可在 Target / Build.cs 的 PublicDefinitions 中显式覆盖。
+ */
+#ifndef SAGASTATS_DAMAGE_TRACE
+#define SAGASTATS_DAMAGE_TRACE !UE_BUILD_SHIPPING
+#endif
+
+/** 单条 Rule 的执行结果 */
+enum class EDamageTraceOutcome : uint8
+{
+	Skipped,    // 谓词不成立
+	Executed,   // 谓词成立，Operation 已执行
+};
+
+/**
+ * 定长二进制追踪记录（24 字节）。
+ * 热路径只做几次 store；名字解析与格式化推迟到导出时。
+ */
+struct FDamageTraceRecord
+{
+	/** Rule 开始执行时的 FPlatformTime::Cycles64() */
+	uint64 StartCycles = 0;
+
+	/** UDamagePipeline::GetUniqueID()（导出时经注册表解析为 Pipeline / Rule 名） */
+	uint32 PipelineId = 0;
+
+	/** FDamageContext::GetContextId() */
+	uint32 ContextId = 0;
+
+	/** Rule 执行耗时（Cycles64 差值，截断到 32 位；逐层并发执行时为 0） */
+	uint32 DurationCycles = 0;
+
+	/** Rule 在编译计划中的下标 */
+	uint16 RuleIndex = 0;
+
+	EDamageTraceOutcome Outcome = EDamageTraceOutcome::Skipped;
+};
+static_assert(sizeof(FDamageTraceRecord) == 24, "FDamageTraceRecord 应保持 24 字节");
+
+/**
+ * FDamagePipelineTrace — 追踪记录的写入与导出。
+ *
+ * 写入：每个线程首次写入时注册一块私有环形缓冲（单生产者 / 单消费者，无锁）；
+ * 缓冲满时丢弃新记录并计数，绝不阻塞执行线程。
+ *
+ * 导出：游戏线程取走全部环中的记录（消费者之间互斥），格式化与写盘放到后台任务。
+ * 控制台命令：
+ *   SagaStats.DamageTrace.Dump            —— 导出到日志
+ *   SagaStats.DamageTrace.DumpFile [Path] —— 导出为 CSV（默认 Saved/Logs/DamageTrace-<时间>.csv）
+ */
+struct SAGASTATS_API FDamagePipelineTrace
+{
+	/** 写入一条 Rule 记录（任意线程） */
+	static void RecordRule(uint32 PipelineId, uint32 ContextId, int32 RuleIndex, bool bExecuted, uint64 StartCycles, bool bTimed = true);
+
+	/** Pipeline 编译时登记 Rule 名表（游戏线程；导出时据此解析 RuleIndex） */
+	static void RegisterPipeline(uint32 PipelineId, const FString& PipelineName, TArray<FName>&& RuleNames);
+
+	/** 取走所有线程环中的全部记录，按 StartCycles 排序后追加到 OutRecords；返回取出条数 */
+	static int32 Drain(TArray<FDamageTraceRecord>& OutRecords);
+
+	/** 取走全部记录并在后台任务中格式化到日志 */
+	static void DumpToLogAsync();
+
+	/** 取走全部记录并在后台任务中写为 CSV */
+	static void DumpToFileAsync(const FString& FilePath);
+
+	/** 因环满被丢弃的记录总数 */
+	static uint32 GetDroppedCount();
+};
+
+#if SAGASTATS_DAMAGE_TRACE
+#define SG_DAMAGE_TRACE_BEGIN(StartVar) const uint64 StartVar = FPlatformTime::Cycles64()
+#define SG_DAMAGE_TRACE_RULE(PipelineId, ContextId, RuleIndex, bExecuted, StartVar) \
+	FDamagePipelineTrace::RecordRule(PipelineId, ContextId, RuleIndex, bExecuted, StartVar)
+#define SG_DAMAGE_TRACE_RULE_UNTIMED(PipelineId, ContextId, RuleIndex, bExecuted) \
+	FDamagePipelineTrace::RecordRule(PipelineId, ContextId, RuleIndex, bExecuted, FPlatformTime::Cycles64(), false)
+#else
+#define SG_DAMAGE_TRACE_BEGIN(StartVar)
+#define SG_DAMAGE_TRACE_RULE(PipelineId, ContextId, RuleIndex, bExecuted, StartVar)
+#define SG_DAMAGE_TRACE_RULE_UNTIMED(PipelineId, ContextId, RuleIndex, bExecuted)
+#endif
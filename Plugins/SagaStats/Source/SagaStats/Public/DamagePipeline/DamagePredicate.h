@@ -11,6 +11,7 @@
 #include "DamagePipeline/DamageCondition.h"
 #include "DamagePredicate.generated.h"
 
+struct FDamageContext;
 class UDamageContext;
 
 /**
@@ -38,9 +39,13 @@ public:
 	UPROPERTY(EditAnywhere, Category = "DamagePredicate")
 	bool bReverse = false;
 
+	bool EvaluatePredicate(const FDamageContext* Context) const;
+
+	/** 以 UDamageContext 求值 */
 	bool EvaluatePredicate(const UDamageContext* Context) const;
+	bool EvaluatePredicate(std::nullptr_t) const { return EvaluatePredicate(static_cast<const FDamageContext*>(nullptr)); }
 
-	virtual bool Evaluate(const UDamageContext* Context) const PURE_VIRTUAL(UDamagePredicate::Evaluate, return false;);
+	virtual bool Evaluate(const FDamageContext* Context) const PURE_VIRTUAL(UDamagePredicate::Evaluate, return false;);
 
 	virtual TArray<UScriptStruct*> GetDependencyEffectTypes() const { return {}; }
 
@@ -91,7 +96,7 @@ public:
 	UPROPERTY(EditAnywhere, Instanced, Category = "DamagePredicate")
 	TObjectPtr<UDamageCondition> Condition;
 
-	virtual bool Evaluate(const UDamageContext* Context) const override;
+	virtual bool Evaluate(const FDamageContext* Context) const override;
 	virtual TArray<UScriptStruct*> GetDependencyEffectTypes() const override;
 	virtual void CollectDisplayLines(
 		const FString& FirstLinePrefix,
@@ -112,7 +117,7 @@ public:
 	UPROPERTY(EditAnywhere, Instanced, Category = "DamagePredicate")
 	TArray<TObjectPtr<UDamagePredicate>> Predicates;
 
-	virtual bool Evaluate(const UDamageContext* Context) const override;
+	virtual bool Evaluate(const FDamageContext* Context) const override;
 	virtual TArray<UScriptStruct*> GetDependencyEffectTypes() const override;
 	virtual void CollectDisplayLines(
 		const FString& FirstLinePrefix,
@@ -133,7 +138,7 @@ public:
 	UPROPERTY(EditAnywhere, Instanced, Category = "DamagePredicate")
 	TArray<TObjectPtr<UDamagePredicate>> Predicates;
 
-	virtual bool Evaluate(const UDamageContext* Context) const override;
+	virtual bool Evaluate(const FDamageContext* Context) const override;
 	virtual TArray<UScriptStruct*> GetDependencyEffectTypes() const override;
 	virtual void CollectDisplayLines(
 		const FString& FirstLinePrefix,
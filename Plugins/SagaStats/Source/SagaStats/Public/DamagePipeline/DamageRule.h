@@ -25,7 +25,7 @@ public:
 	/** 从 OperationClass CDO 获取此 DamageRule 产出的 Effect 类型 */
 	UScriptStruct* GetProducesEffectType() const;
 
-	/** 从 Condition 谓词树中提取依赖的 EffectType 列表（用于拓扑排序） */
+	/** 依赖的 EffectType 列表：Condition 谓词树 + OperationClass CDO 声明的读取（用于拓扑排序） */
 	TArray<UScriptStruct*> GetConsumedEffectTypes() const;
 	
 	/** Condition 谓词容器（Predicate/Condition 双层，可为空 = 始终执行） */
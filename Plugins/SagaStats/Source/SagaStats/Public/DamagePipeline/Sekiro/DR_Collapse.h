@@ -45,8 +45,8 @@ class SAGASTATS_API UDamageCondition_CollapseIsCollapse : public UDamageConditio
 {
 	GENERATED_BODY()
 public:
-	UDamageCondition_CollapseIsCollapse() { EffectType = FCollapseEffect::StaticStruct(); }
-	virtual bool Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& ConsumedEffect) const override;
+	UDamageCondition_CollapseIsCollapse() { EffectType = FCollapseEffect::StaticStruct(); bThreadSafe = true; }
+	virtual bool EvaluateView(const FDamageContext* Context, FConstStructView ConsumedEffect) const override;
 };
 
 // ============================================================================
@@ -58,8 +58,8 @@ class SAGASTATS_API UDamageCondition_CollapseGuardIsCollapse : public UDamageCon
 {
 	GENERATED_BODY()
 public:
-	UDamageCondition_CollapseGuardIsCollapse() { EffectType = FCollapseGuardEffect::StaticStruct(); }
-	virtual bool Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& ConsumedEffect) const override;
+	UDamageCondition_CollapseGuardIsCollapse() { EffectType = FCollapseGuardEffect::StaticStruct(); bThreadSafe = true; }
+	virtual bool EvaluateView(const FDamageContext* Context, FConstStructView ConsumedEffect) const override;
 };
 
 // ============================================================================
@@ -71,8 +71,8 @@ class SAGASTATS_API UDamageOperation_Collapse : public UDamageOperationBase
 {
 	GENERATED_BODY()
 public:
-	UDamageOperation_Collapse() { EffectType = FCollapseEffect::StaticStruct(); }
-	virtual void Execute_Implementation(UDamageContext* Context, FInstancedStruct& OutEffect) override;
+	UDamageOperation_Collapse() { EffectType = FCollapseEffect::StaticStruct(); bThreadSafe = true; }
+	virtual bool ExecuteInPlace(FDamageContext* Context, FStructView OutEffect) override;
 };
 
 UCLASS(HideDropDown)
@@ -80,6 +80,6 @@ class SAGASTATS_API UDamageOperation_CollapseGuard : public UDamageOperationBase
 {
 	GENERATED_BODY()
 public:
-	UDamageOperation_CollapseGuard() { EffectType = FCollapseGuardEffect::StaticStruct(); }
-	virtual void Execute_Implementation(UDamageContext* Context, FInstancedStruct& OutEffect) override;
+	UDamageOperation_CollapseGuard() { EffectType = FCollapseGuardEffect::StaticStruct(); bThreadSafe = true; }
+	virtual bool ExecuteInPlace(FDamageContext* Context, FStructView OutEffect) override;
 };
@@ -33,8 +33,8 @@ class SAGASTATS_API UDamageCondition_CollapseJustGuard : public UDamageCondition
 {
 	GENERATED_BODY()
 public:
-	UDamageCondition_CollapseJustGuard() { EffectType = FCollapseJustGuardEffect::StaticStruct(); }
-	virtual bool Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& ConsumedEffect) const override { return ConsumedEffect.IsValid(); }
+	UDamageCondition_CollapseJustGuard() { EffectType = FCollapseJustGuardEffect::StaticStruct(); bThreadSafe = true; }
+	virtual bool EvaluateView(const FDamageContext* Context, FConstStructView ConsumedEffect) const override { return ConsumedEffect.IsValid(); }
 };
 
 // ============================================================================
@@ -46,6 +46,6 @@ class SAGASTATS_API UDamageOperation_CollapseJustGuard : public UDamageOperation
 {
 	GENERATED_BODY()
 public:
-	UDamageOperation_CollapseJustGuard() { EffectType = FCollapseJustGuardEffect::StaticStruct(); }
-	virtual void Execute_Implementation(UDamageContext* Context, FInstancedStruct& OutEffect) override;
+	UDamageOperation_CollapseJustGuard() { EffectType = FCollapseJustGuardEffect::StaticStruct(); bThreadSafe = true; }
+	virtual bool ExecuteInPlace(FDamageContext* Context, FStructView OutEffect) override;
 };
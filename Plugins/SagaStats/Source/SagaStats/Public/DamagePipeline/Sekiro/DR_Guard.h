@@ -12,6 +12,7 @@
 #include "DamagePipeline/DamageOperationBase.h"
 #include "DamagePipeline/DamageCondition_Effect.h"
 #include "DamagePipeline/DamageContext.h"
+#include "DamagePipeline/Sekiro/DR_Mixup.h"
 #include "DR_Guard.generated.h"
 
 // ============================================================================
@@ -39,8 +40,8 @@ class SAGASTATS_API UDamageCondition_GuardSuccess : public UDamageCondition_Effe
 {
 	GENERATED_BODY()
 public:
-	UDamageCondition_GuardSuccess() { EffectType = FGuardEffect::StaticStruct(); }
-	virtual bool Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& ConsumedEffect) const override;
+	UDamageCondition_GuardSuccess() { EffectType = FGuardEffect::StaticStruct(); bThreadSafe = true; }
+	virtual bool EvaluateView(const FDamageContext* Context, FConstStructView ConsumedEffect) const override;
 };
 
 UCLASS(BlueprintType, HideDropDown, meta = (DisplayName = "GuardIsJustGuard"))
@@ -48,8 +49,8 @@ class SAGASTATS_API UDamageCondition_GuardIsJustGuard : public UDamageCondition_
 {
 	GENERATED_BODY()
 public:
-	UDamageCondition_GuardIsJustGuard() { EffectType = FGuardEffect::StaticStruct(); }
-	virtual bool Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& ConsumedEffect) const override;
+	UDamageCondition_GuardIsJustGuard() { EffectType = FGuardEffect::StaticStruct(); bThreadSafe = true; }
+	virtual bool EvaluateView(const FDamageContext* Context, FConstStructView ConsumedEffect) const override;
 };
 
 // ============================================================================
@@ -61,6 +62,11 @@ class SAGASTATS_API UDamageOperation_Guard : public UDamageOperationBase
 {
 	GENERATED_BODY()
 public:
-	UDamageOperation_Guard() { EffectType = FGuardEffect::StaticStruct(); }
-	virtual void Execute_Implementation(UDamageContext* Context, FInstancedStruct& OutEffect) override;
+	UDamageOperation_Guard()
+	{
+		EffectType = FGuardEffect::StaticStruct();
+		ConsumedEffectTypes.Add(FMixupEffect::StaticStruct());
+		bThreadSafe = true;
+	}
+	virtual bool ExecuteInPlace(FDamageContext* Context, FStructView OutEffect) override;
 };
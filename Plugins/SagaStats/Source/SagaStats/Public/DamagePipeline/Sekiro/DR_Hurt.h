@@ -36,8 +36,8 @@ class SAGASTATS_API UDamageCondition_IsHurt : public UDamageCondition_Effect
 {
 	GENERATED_BODY()
 public:
-	UDamageCondition_IsHurt() { EffectType = FHurtEffect::StaticStruct(); }
-	virtual bool Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& ConsumedEffect) const override;
+	UDamageCondition_IsHurt() { EffectType = FHurtEffect::StaticStruct(); bThreadSafe = true; }
+	virtual bool EvaluateView(const FDamageContext* Context, FConstStructView ConsumedEffect) const override;
 };
 
 // ============================================================================
@@ -49,6 +49,6 @@ class SAGASTATS_API UDamageOperation_Hurt : public UDamageOperationBase
 {
 	GENERATED_BODY()
 public:
-	UDamageOperation_Hurt() { EffectType = FHurtEffect::StaticStruct(); }
-	virtual void Execute_Implementation(UDamageContext* Context, FInstancedStruct& OutEffect) override;
+	UDamageOperation_Hurt() { EffectType = FHurtEffect::StaticStruct(); bThreadSafe = true; }
+	virtual bool ExecuteInPlace(FDamageContext* Context, FStructView OutEffect) override;
 };
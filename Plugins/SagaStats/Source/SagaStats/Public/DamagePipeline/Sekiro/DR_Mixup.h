@@ -12,6 +12,7 @@
 #include "DamagePipeline/DamageOperationBase.h"
 #include "DamagePipeline/DamageCondition_Effect.h"
 #include "DamagePipeline/DamageContext.h"
+#include "DamagePipeline/Sekiro/SekiroAttackContext.h"
 #include "DR_Mixup.generated.h"
 
 // ============================================================================
@@ -39,8 +40,8 @@ class SAGASTATS_API UDamageCondition_IsGuard : public UDamageCondition_Effect
 {
 	GENERATED_BODY()
 public:
-	UDamageCondition_IsGuard() { EffectType = FMixupEffect::StaticStruct(); }
-	virtual bool Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& ConsumedEffect) const override;
+	UDamageCondition_IsGuard() { EffectType = FMixupEffect::StaticStruct(); bThreadSafe = true; }
+	virtual bool EvaluateView(const FDamageContext* Context, FConstStructView ConsumedEffect) const override;
 };
 
 UCLASS(BlueprintType, HideDropDown, meta = (DisplayName = "IsJustGuard"))
@@ -48,8 +49,8 @@ class SAGASTATS_API UDamageCondition_IsJustGuard : public UDamageCondition_Effec
 {
 	GENERATED_BODY()
 public:
-	UDamageCondition_IsJustGuard() { EffectType = FMixupEffect::StaticStruct(); }
-	virtual bool Evaluate_Implementation(const UDamageContext* Context, const FInstancedStruct& ConsumedEffect) const override;
+	UDamageCondition_IsJustGuard() { EffectType = FMixupEffect::StaticStruct(); bThreadSafe = true; }
+	virtual bool EvaluateView(const FDamageContext* Context, FConstStructView ConsumedEffect) const override;
 };
 
 // ============================================================================
@@ -61,6 +62,11 @@ class SAGASTATS_API UDamageOperation_Mixup : public UDamageOperationBase
 {
 	GENERATED_BODY()
 public:
-	UDamageOperation_Mixup() { EffectType = FMixupEffect::StaticStruct(); }
-	virtual void Execute_Implementation(UDamageContext* Context, FInstancedStruct& OutEffect) override;
+	UDamageOperation_Mixup()
+	{
+		EffectType = FMixupEffect::StaticStruct();
+		ConsumedEffectTypes.Add(FSekiroAttackContext::StaticStruct());
+		bThreadSafe = true;
+	}
+	virtual bool ExecuteInPlace(FDamageContext* Context, FStructView OutEffect) override;
 };
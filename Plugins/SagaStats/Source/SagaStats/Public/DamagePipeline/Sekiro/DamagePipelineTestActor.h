@@ -47,7 +47,7 @@ private:
 
 	void BuildSekiroPipeline();
 	void PrintToScreen(const FString& Message, FColor Color = FColor::White) const;
-	void PrintScenarioResult(const FString& ScenarioName, UDamageContext* Context,
+	void PrintScenarioResult(const FString& ScenarioName, const FDamageContext* Context,
 		const TArray<FRuleExecutionEntry>& Log) const;
 
 	void RunScenario_NormalHit();